@@ -0,0 +1,311 @@
+/*
+ * adc_capture.c
+ *
+ * Reading and writing the binary capture format in adc_capture.h.  The
+ * file is mapped read-only with MADV_SEQUENTIAL, so the kernel reads ahead
+ * as the frames are walked and pages can be dropped behind; nothing is
+ * parsed and, for float64 captures, nothing is copied.
+ *
+ * Multi-byte fields are assembled from bytes, which the compiler turns
+ * into plain loads on little-endian hosts and which still gives the right
+ * answer on big-endian ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "adc_capture.h"
+#include "adc_text.h"
+
+#define CHUNK 4096   // samples per fwrite() in the text converter
+
+struct adc_capture
+{
+   struct adc_capture_info info;
+   const unsigned char *map;     // the whole file
+   size_t size;
+   const unsigned char *data;    // first sample
+   int sample_bytes;
+   double volts_per_count;       // 1 for ADC_FLOAT64
+};
+
+
+static uint16_t get16(const unsigned char *p)
+{
+   return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+   return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+          (uint32_t)p[3] << 24;
+}
+
+static uint64_t get64(const unsigned char *p)
+{
+   return get32(p) | (uint64_t)get32(p + 4) << 32;
+}
+
+static double get_double(const unsigned char *p)
+{
+   uint64_t u = get64(p);
+   double d;
+
+   memcpy(&d, &u, sizeof(d));
+   return d;
+}
+
+static void put16(unsigned char *p, uint16_t v)
+{
+   p[0] = v & 0xff;
+   p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+   put16(p, v & 0xffff);
+   put16(p + 2, v >> 16);
+}
+
+static void put64(unsigned char *p, uint64_t v)
+{
+   put32(p, v & 0xffffffff);
+   put32(p + 4, v >> 32);
+}
+
+static void put_double(unsigned char *p, double d)
+{
+   uint64_t u;
+
+   memcpy(&u, &d, sizeof(u));
+   put64(p, u);
+}
+
+static int little_endian(void)
+{
+   const uint16_t one = 1;
+   return *(const unsigned char *)&one == 1;
+}
+
+static int sample_bytes(int format)
+{
+   switch (format)
+   {
+   case ADC_INT16:
+      return 2;
+   case ADC_INT32:
+      return 4;
+   case ADC_FLOAT64:
+      return 8;
+   default:
+      return 0;
+   }
+}
+
+adc_capture *adc_capture_open(const char *path)
+{
+   struct stat st;
+   adc_capture *cap;
+   const unsigned char *h;
+   void *map;
+   int fd;
+
+   fd = open(path, O_RDONLY);
+   if (fd < 0)
+      return NULL;
+   if (fstat(fd, &st) < 0 || st.st_size < ADC_HEADER_SIZE)
+   {
+      close(fd);
+      return NULL;
+   }
+   map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);   // the mapping keeps the file
+   if (map == MAP_FAILED)
+      return NULL;
+   cap = calloc(1, sizeof(*cap));
+   if (!cap)
+   {
+      munmap(map, st.st_size);
+      return NULL;
+   }
+   cap->map = map;
+   cap->size = st.st_size;
+
+   h = cap->map;
+   cap->info.sample_rate = get32(h + 8);
+   cap->info.bits = get16(h + 12);
+   cap->info.channels = get16(h + 14);
+   cap->info.format = get32(h + 16);
+   cap->info.frames = (int64_t)get64(h + 24);
+   cap->info.full_scale = get_double(h + 32);
+   cap->sample_bytes = sample_bytes(cap->info.format);
+   cap->data = h + ADC_HEADER_SIZE;
+   if (memcmp(h, "ADCB", 4) != 0 || get32(h + 4) != 1 ||
+       cap->sample_bytes == 0 || cap->info.channels < 1 ||
+       cap->info.bits < 1 || cap->info.bits > 32 || cap->info.frames < 0 ||
+       (uint64_t)cap->info.frames > (cap->size - ADC_HEADER_SIZE) /
+                                    cap->sample_bytes / cap->info.channels)
+   {
+      adc_capture_close(cap);
+      return NULL;
+   }
+   cap->volts_per_count = cap->info.format == ADC_FLOAT64 ? 1.0 :
+      cap->info.full_scale / (ldexp(1.0, cap->info.bits) - 1.0);
+   madvise((void *)cap->map, cap->size, MADV_SEQUENTIAL);
+   return cap;
+}
+
+void adc_capture_close(adc_capture *cap)
+{
+   if (!cap)
+      return;
+   munmap((void *)cap->map, cap->size);
+   free(cap);
+}
+
+const struct adc_capture_info *adc_capture_info(const adc_capture *cap)
+{
+   return &cap->info;
+}
+
+const double *adc_capture_frames(const adc_capture *cap)
+{
+   if (cap->info.format != ADC_FLOAT64 || !little_endian())
+      return NULL;
+   return (const double *)cap->data;
+}
+
+const double *adc_capture_volts(const adc_capture *cap)
+{
+   return cap->info.channels == 1 ? adc_capture_frames(cap) : NULL;
+}
+
+/* count samples stride bytes apart from p, in volts. */
+static void convert(const adc_capture *cap, const unsigned char *p,
+                    int stride, int64_t count, double *out)
+{
+   const double scale = cap->volts_per_count;
+   int64_t i;
+
+   switch (cap->info.format)
+   {
+   case ADC_INT16:
+      for (i = 0; i < count; i++, p += stride)
+         out[i] = (int16_t)get16(p) * scale;
+      break;
+   case ADC_INT32:
+      for (i = 0; i < count; i++, p += stride)
+         out[i] = (int32_t)get32(p) * scale;
+      break;
+   default:
+      for (i = 0; i < count; i++, p += stride)
+         out[i] = get_double(p);
+      break;
+   }
+}
+
+/* count clipped to the frames there are from first, 0 if none. */
+static int64_t clip(const adc_capture *cap, int64_t first, int64_t count)
+{
+   if (first < 0 || first >= cap->info.frames || count <= 0)
+      return 0;
+   return count < cap->info.frames - first ? count
+                                           : cap->info.frames - first;
+}
+
+int64_t adc_capture_read(const adc_capture *cap, int channel, int64_t first,
+                         int64_t count, double *out)
+{
+   const int stride = cap->sample_bytes * cap->info.channels;
+
+   if (channel < 0 || channel >= cap->info.channels)
+      return 0;
+   count = clip(cap, first, count);
+   convert(cap, cap->data + first * stride + channel * cap->sample_bytes,
+           stride, count, out);
+   return count;
+}
+
+int64_t adc_capture_read_frames(const adc_capture *cap, int64_t first,
+                                int64_t count, double *out)
+{
+   const int channels = cap->info.channels;
+
+   count = clip(cap, first, count);
+   convert(cap, cap->data + first * channels * cap->sample_bytes,
+           cap->sample_bytes, count * channels, out);
+   return count;
+}
+
+int64_t adc_capture_from_text(const char *txt_path, const char *bin_path,
+                              int format, uint32_t sample_rate, int bits,
+                              double full_scale, int channels)
+{
+   unsigned char header[ADC_HEADER_SIZE] = { 0 };
+   unsigned char buf[CHUNK * 8];
+   const int size = sample_bytes(format);
+   const double lo = format == ADC_INT16 ? INT16_MIN : INT32_MIN;
+   const double hi = format == ADC_INT16 ? INT16_MAX : INT32_MAX;
+   struct adc_text text;
+   int64_t frames, total, at;
+   double v;
+   FILE *op;
+   int count, i, err;
+
+   if (size == 0 || bits < 1 || bits > 32 || channels < 1 ||
+       channels > UINT16_MAX)
+      return -1;
+   if (adc_text_read(txt_path, 1.0, &text) < 0)
+      return -1;
+   op = fopen(bin_path, "wb");
+   if (!op)
+   {
+      adc_text_free(&text);
+      return -1;
+   }
+   // A last frame short of some channels is filled out with zeros.
+   frames = (text.count + channels - 1) / channels;
+   total = frames * channels;
+
+   memcpy(header, "ADCB", 4);
+   put32(header + 4, 1);
+   put32(header + 8, sample_rate);
+   put16(header + 12, bits);
+   put16(header + 14, channels);
+   put32(header + 16, format);
+   put64(header + 24, frames);
+   put_double(header + 32, full_scale);
+   fwrite(header, sizeof(header), 1, op);
+
+   for (at = 0; at < total; at += count)
+   {
+      count = total - at < CHUNK ? total - at : CHUNK;
+      for (i = 0; i < count; i++)
+      {
+         v = at + i < text.count ? text.samples[at + i] : 0.0;
+         if (format == ADC_FLOAT64)
+         {
+            put_double(buf + 8 * i,
+                       v * full_scale / (ldexp(1.0, bits) - 1.0));
+            continue;
+         }
+         v = v < lo ? lo : v > hi ? hi : round(v);
+         if (format == ADC_INT16)
+            put16(buf + 2 * i, (uint16_t)(int16_t)v);
+         else
+            put32(buf + 4 * i, (uint32_t)(int32_t)v);
+      }
+      fwrite(buf, size, count, op);
+   }
+
+   err = ferror(op);
+   adc_text_free(&text);
+   if (fclose(op) != 0 || err)
+      return -1;
+   return frames;
+}
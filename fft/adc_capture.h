@@ -0,0 +1,87 @@
+/*
+ * adc_capture.h
+ *
+ * Binary ADC capture files, read through mmap() so that a multi-gigabyte
+ * capture costs no parsing and no copy into memory of our own.
+ *
+ * A capture is a 64-byte header followed by the samples, channels
+ * interleaved (sample t of channel c is sample t * channels + c), all
+ * little-endian:
+ *
+ *   offset  size
+ *        0     4  magic "ADCB"
+ *        4     4  version, 1
+ *        8     4  sample rate in Hz (0 if unknown)
+ *       12     2  bits per sample the ADC delivers, e.g. 12
+ *       14     2  channels
+ *       16     4  sample format, ADC_INT16, ADC_INT32 or ADC_FLOAT64
+ *       20     4  reserved, 0
+ *       24     8  frames (samples per channel)
+ *       32     8  full-scale voltage as an IEEE double: an integer count c
+ *                 is c * full_scale / (2^bits - 1) volts
+ *       40    24  reserved, 0
+ *
+ * ADC_FLOAT64 samples are already volts.  Since the header is 64 bytes,
+ * they are aligned, so on a little-endian host a single-channel float64
+ * capture can be handed to the FFT straight from the mapping.  Integer
+ * captures are converted to volts frame by frame into a caller buffer.
+ */
+#ifndef ADC_CAPTURE_H
+#define ADC_CAPTURE_H
+
+#include <stdint.h>
+
+#define ADC_INT16   1
+#define ADC_INT32   2
+#define ADC_FLOAT64 3
+
+#define ADC_HEADER_SIZE 64
+
+struct adc_capture_info
+{
+   uint32_t sample_rate;
+   int bits;
+   int channels;
+   int format;               // ADC_INT16, ...
+   int64_t frames;
+   double full_scale;
+};
+
+typedef struct adc_capture adc_capture;
+
+/* Maps the capture at path.  Returns NULL if it cannot be opened or its
+   header is not valid, or the file is shorter than the header says. */
+adc_capture *adc_capture_open(const char *path);
+void adc_capture_close(adc_capture *cap);
+
+const struct adc_capture_info *adc_capture_info(const adc_capture *cap);
+
+/* The samples of a single-channel ADC_FLOAT64 capture on a little-endian
+   host, in place in the mapping, or NULL for any other capture. */
+const double *adc_capture_volts(const adc_capture *cap);
+
+/* The same for any number of channels, still interleaved. */
+const double *adc_capture_frames(const adc_capture *cap);
+
+/* Converts count samples of channel, starting at frame first, to volts in
+   out.  Returns how many there were, fewer than count at the end of the
+   capture. */
+int64_t adc_capture_read(const adc_capture *cap, int channel, int64_t first,
+                         int64_t count, double *out);
+
+/* The same for all channels at once, left interleaved: count frames of
+   info.channels samples each, in one pass through the file. */
+int64_t adc_capture_read_frames(const adc_capture *cap, int64_t first,
+                                int64_t count, double *out);
+
+/* Writes a capture at bin_path from the numbers in the text file
+   txt_path, read by adc_text_read(), one sample per number with channels
+   channels interleaved.  format is the sample format to store; integer
+   formats keep the numbers as counts of a bits-bit ADC with the given full
+   scale, rounded and clamped to the format, and ADC_FLOAT64 stores them as
+   volts.  Returns the number of frames written, or -1 on failure. */
+int64_t adc_capture_from_text(const char *txt_path, const char *bin_path,
+                              int format, uint32_t sample_rate, int bits,
+                              double full_scale, int channels);
+
+#endif
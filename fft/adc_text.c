@@ -0,0 +1,196 @@
+/*
+ * adc_text.c
+ *
+ * The parser of adc_text.h.  The file is read into one buffer with a few
+ * zero bytes after it, so the digit loop can look eight bytes ahead
+ * without checking for the end.  Eight digits are checked and converted
+ * at once in a 64-bit word (a SIMD register of eight byte lanes, in plain
+ * C), which takes a typical sample in one or two steps.  The samples go
+ * straight into a buffer big enough for the most numbers the file could
+ * hold, shrunk once at the end; pages never written are never touched.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "adc_text.h"
+
+#define PAD 16   // zero bytes after the text
+
+/* Powers of ten, all exact in a double. */
+static const double pow10[] =
+{
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+   1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/* Bytes p[0..7], p[0] in the low byte whatever the host's byte order. */
+static uint64_t load8(const unsigned char *p)
+{
+   return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+          (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 |
+          (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+/* The top bit of every byte that is not '0'..'9', at least up to the first
+   such byte: adding 0x46 carries into it above '9', subtracting 0x30
+   borrows into it below '0'. */
+static uint64_t non_digits(uint64_t v)
+{
+   return ((v + 0x4646464646464646ULL) | (v - 0x3030303030303030ULL)) &
+          0x8080808080808080ULL;
+}
+
+/* The eight digits as a number, first byte most significant: pairs, then
+   fours, then the eight are combined with one multiply each. */
+static uint32_t parse8(uint64_t v)
+{
+   v -= 0x3030303030303030ULL;
+   v = v * 10 + (v >> 8);
+   v = ((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32)) +
+        ((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32))) >> 32;
+   return (uint32_t)v;
+}
+
+static int is_space(int c)
+{
+   return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+          c == '\f';
+}
+
+/* Digits at *pp into *mant, returning how many there were; *mant is only
+   meaningful while that stays at most 19.  Fewer than eight digits are
+   shifted to the low-order end of the word, behind '0's, and converted
+   the same way, so a short sample takes no branch on its length. */
+static int digits(const unsigned char **pp, uint64_t *mant)
+{
+   static const uint32_t scale[] =
+      { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+   const unsigned char *p = *pp;
+   uint64_t m = *mant, v, stop;
+   int n = 0, len;
+
+   while (v = load8(p), (stop = non_digits(v)) == 0)
+   {
+      m = m * 100000000 + parse8(v);
+      p += 8;
+      n += 8;
+   }
+   len = __builtin_ctzll(stop) / 8;
+   if (len > 0)
+   {
+      v = v << (64 - 8 * len) | 0x3030303030303030ULL >> 8 * len;
+      m = m * scale[len] + parse8(v);
+   }
+   *pp = p + len;
+   *mant = m;
+   return n + len;
+}
+
+/* Parses len bytes at buf, followed by PAD zero bytes, into t->samples. */
+static void parse(const unsigned char *buf, size_t len, double scale,
+                  struct adc_text *t)
+{
+   const unsigned char *p = buf, *end = buf + len, *start, *nl;
+   int64_t line = 1, count = 0;
+   uint64_t mant;
+   double v;
+   char *q;
+   int neg, n, frac;
+
+   for (;;)
+   {
+      while (p < end && is_space(*p))
+         if (*p++ == '\n')
+            line++;
+      if (p >= end)
+         break;
+
+      start = p;
+      neg = *p == '-';
+      if (*p == '-' || *p == '+')
+         p++;
+      mant = 0;
+      n = digits(&p, &mant);
+      frac = 0;
+      if (*p == '.')
+      {
+         p++;
+         frac = digits(&p, &mant);
+         n += frac;
+      }
+      if (n > 0 && n <= 19 && frac <= 22 && mant < (1ULL << 53) &&
+          (p >= end || is_space(*p)))
+      {
+         // Both exact, so the one division rounds correctly.
+         v = (double)mant / pow10[frac];
+         t->samples[count++] = (neg ? -v : v) * scale;
+         continue;
+      }
+      if (n > 0)
+      {
+         // Exponents and long mantissas.
+         v = strtod((const char *)start, &q);
+         p = (const unsigned char *)q;
+         if (p > start && (p >= end || is_space(*p)))
+         {
+            t->samples[count++] = v * scale;
+            continue;
+         }
+      }
+      // Not a number: drop the rest of the line.
+      t->bad_lines++;
+      if (!t->first_bad)
+         t->first_bad = line;
+      nl = memchr(p, '\n', end - p);
+      p = nl ? nl : end;
+   }
+   t->count = count;
+}
+
+int adc_text_read(const char *path, double scale, struct adc_text *t)
+{
+   unsigned char *buf;
+   struct stat st;
+   size_t len;
+   double *shrunk;
+   FILE *fp;
+
+   memset(t, 0, sizeof(*t));
+   fp = fopen(path, "rb");
+   if (!fp)
+      return -1;
+   if (fstat(fileno(fp), &st) < 0)
+   {
+      fclose(fp);
+      return -1;
+   }
+   len = st.st_size;
+   buf = malloc(len + PAD);
+   // Every number takes at least one byte and one separator.
+   t->samples = malloc((len / 2 + 1) * sizeof(*t->samples));
+   if (!buf || !t->samples || fread(buf, 1, len, fp) != len)
+   {
+      fclose(fp);
+      free(buf);
+      adc_text_free(t);
+      return -1;
+   }
+   fclose(fp);
+   memset(buf + len, 0, PAD);
+
+   parse(buf, len, scale, t);
+   free(buf);
+   shrunk = realloc(t->samples, (t->count + 1) * sizeof(*t->samples));
+   if (shrunk)
+      t->samples = shrunk;
+   return 0;
+}
+
+void adc_text_free(struct adc_text *t)
+{
+   free(t->samples);
+   memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,33 @@
+/*
+ * adc_text.h
+ *
+ * Text ADC captures, the format rohan_data.txt has always had: decimal
+ * numbers separated by white space, normally one per line.  The whole file
+ * is read into memory and converted in one pass into a buffer of doubles
+ * sized to the file, instead of one fscanf() call per sample.
+ *
+ * Plain decimals such as "-123" or "0.75", up to 19 digits, are converted
+ * here eight digits at a time and are correctly rounded; anything else a
+ * C program would take for a number ("1e-3", very long mantissas) goes to
+ * strtod().  A line that has something which is not a number on it is
+ * skipped from that point on and counted as malformed.
+ */
+#ifndef ADC_TEXT_H
+#define ADC_TEXT_H
+
+#include <stdint.h>
+
+struct adc_text
+{
+   double *samples;        // count numbers, each multiplied by scale
+   int64_t count;
+   int64_t bad_lines;      // lines with something other than numbers
+   int64_t first_bad;      // the first of them, counting from 1, or 0
+};
+
+/* Reads every number in the text file at path into t.  Returns 0, or -1
+   if the file cannot be read or memory runs out. */
+int adc_text_read(const char *path, double scale, struct adc_text *t);
+void adc_text_free(struct adc_text *t);
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * cufft.h
+ *
+ * The part of the cuFFT API we use, implemented on the CPU by
+ * cufft_cpu.c on top of the engine in fft.h.  Code written against cuFFT
+ * builds unchanged on machines without CUDA by putting this directory on
+ * the include path and linking cufft_cpu.o instead of -lcufft.  The
+ * "device" pointers passed to the cufftExec*() calls are ordinary host
+ * memory.
+ *
+ * Differences from the real library:
+ *
+ *   - CUFFT_C2C lengths must be powers of two, and the real-data types
+ *     need even lengths (CUFFT_INVALID_SIZE otherwise).
+ *   - Only rank 1 is supported by cufftPlanMany().
+ *   - Calls run synchronously on a thread pool owned by the plan, one
+ *     thread per CPU; there are no streams.
+ *   - A plan must not be executed from two threads at once.
+ */
+#ifndef CUFFT_H
+#define CUFFT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct { float x, y; } cufftComplex;
+typedef struct { double x, y; } cufftDoubleComplex;
+typedef float cufftReal;
+typedef double cufftDoubleReal;
+
+typedef int cufftHandle;
+
+typedef enum cufftResult_t
+{
+   CUFFT_SUCCESS        = 0x0,
+   CUFFT_INVALID_PLAN   = 0x1,
+   CUFFT_ALLOC_FAILED   = 0x2,
+   CUFFT_INVALID_TYPE   = 0x3,
+   CUFFT_INVALID_VALUE  = 0x4,
+   CUFFT_INTERNAL_ERROR = 0x5,
+   CUFFT_EXEC_FAILED    = 0x6,
+   CUFFT_SETUP_FAILED   = 0x7,
+   CUFFT_INVALID_SIZE   = 0x8,
+   CUFFT_NOT_SUPPORTED  = 0x10
+} cufftResult;
+
+typedef enum cufftType_t
+{
+   CUFFT_R2C = 0x2a,   // real to complex, single precision
+   CUFFT_C2R = 0x2c,
+   CUFFT_C2C = 0x29,
+   CUFFT_D2Z = 0x6a,   // same in double precision
+   CUFFT_Z2D = 0x6c,
+   CUFFT_Z2Z = 0x69
+} cufftType;
+
+#define CUFFT_FORWARD -1
+#define CUFFT_INVERSE  1
+
+/* batch transforms of nx points stored back to back.  Real-to-complex
+   frames are nx reals in and nx/2 + 1 bins out, and the reverse for
+   complex-to-real; run in place, the real frames are 2*(nx/2 + 1) values
+   apart. */
+cufftResult cufftPlan1d(cufftHandle *plan, int nx, cufftType type, int batch);
+
+/* The general layout: with inembed (onembed) NULL, the frames are packed
+   as in cufftPlan1d() and istride/idist (ostride/odist) are ignored;
+   otherwise element k of frame f is at f*idist + k*istride. */
+cufftResult cufftPlanMany(cufftHandle *plan, int rank, int *n,
+                          int *inembed, int istride, int idist,
+                          int *onembed, int ostride, int odist,
+                          cufftType type, int batch);
+
+/* Unnormalised in both directions, like cuFFT: an inverse after a forward
+   transform returns nx times the input.  idata and odata may be the same
+   array.  For the real types that needs the padded layout of cuFFT, with
+   each real frame taking 2*(nx/2 + 1) values, which is what plans with
+   the default layout expect when run in place; in an advanced layout the
+   frames must not overlap each other. */
+cufftResult cufftExecC2C(cufftHandle plan, cufftComplex *idata,
+                         cufftComplex *odata, int direction);
+cufftResult cufftExecZ2Z(cufftHandle plan, cufftDoubleComplex *idata,
+                         cufftDoubleComplex *odata, int direction);
+cufftResult cufftExecR2C(cufftHandle plan, cufftReal *idata,
+                         cufftComplex *odata);
+cufftResult cufftExecD2Z(cufftHandle plan, cufftDoubleReal *idata,
+                         cufftDoubleComplex *odata);
+cufftResult cufftExecC2R(cufftHandle plan, cufftComplex *idata,
+                         cufftReal *odata);
+cufftResult cufftExecZ2D(cufftHandle plan, cufftDoubleComplex *idata,
+                         cufftDoubleReal *odata);
+
+cufftResult cufftDestroy(cufftHandle plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
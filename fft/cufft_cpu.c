@@ -0,0 +1,466 @@
+/*
+ * cufft_cpu.c
+ *
+ * cuFFT entry points (see cufft.h) running on the CPU engine.
+ *
+ * Each handle indexes a table of plans.  Double-precision complex batches
+ * go straight to fft_batch_plan, which already takes the cufftPlanMany()
+ * layout.  Single-precision complex frames run through an fftf_plan and
+ * the real-data types through an fft_real_plan (in double precision,
+ * converting on the way in and out); both are shared out over a thread
+ * pool a group of frames at a time, gathering strided frames into
+ * per-thread scratch.
+ *
+ * The complex types keep a forward and an FFT_INVERSE plan side by side,
+ * since cuFFT only gives the direction when the plan is executed.
+ *
+ * Run in place with the default layout, the real types pad each real
+ * frame to 2*(n/2 + 1) values as cuFFT does, so that the bins of a frame
+ * land on its own samples and not on the next frame's.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "cufft.h"
+#include "fft_internal.h"
+
+#define CUFFT_MAX_PLANS 1024
+
+struct cufft_plan
+{
+   cufftType type;
+   int n, batch;
+   int istride, idist, ostride, odist;
+   int inplace_idist, inplace_odist;   // the distances when in == out
+   fft_batch_plan *zbatch;    // CUFFT_Z2Z
+   fft_batch_plan *zbatch_inv;
+   fftf_plan *cplan;          // CUFFT_C2C
+   fftf_plan *cplan_inv;
+   fft_real_plan *rplan;      // the real-data types
+   fft_pool *pool;
+   int nslots;
+   int frames_per_task;
+   void **scratch;            // one buffer per pool slot
+};
+
+/* What the pool tasks need to see. */
+struct cufft_job
+{
+   const struct cufft_plan *plan;
+   const void *in;
+   void *out;
+   int idist, odist;
+   int inverse;
+};
+
+static struct cufft_plan *plans[CUFFT_MAX_PLANS];
+static pthread_mutex_t plans_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static int is_single(cufftType type)
+{
+   return type == CUFFT_C2C || type == CUFFT_R2C || type == CUFFT_C2R;
+}
+
+static void destroy_plan(struct cufft_plan *p)
+{
+   int i;
+
+   if (!p)
+      return;
+   fft_batch_plan_destroy(p->zbatch);
+   fft_batch_plan_destroy(p->zbatch_inv);
+   fftf_plan_destroy(p->cplan);
+   fftf_plan_destroy(p->cplan_inv);
+   fft_real_plan_destroy(p->rplan);
+   fft_pool_destroy(p->pool);
+   if (p->scratch)
+      for (i = 0; i < p->nslots; i++)
+         free(p->scratch[i]);
+   free(p->scratch);
+   free(p);
+}
+
+/* Engine plans and scratch for everything but CUFFT_Z2Z. */
+static int setup_frames(struct cufft_plan *p)
+{
+   size_t bytes;
+   int i, tasks;
+
+   if (p->type == CUFFT_C2C)
+   {
+      p->cplan = fftf_plan_create(p->n, 0);
+      p->cplan_inv = fftf_plan_create(p->n, FFT_INVERSE);
+      if (!p->cplan || !p->cplan_inv)
+         return -1;
+      i = fftf_work_size(p->cplan) > fftf_work_size(p->cplan_inv) ?
+          fftf_work_size(p->cplan) : fftf_work_size(p->cplan_inv);
+      bytes = ((size_t)p->n + i) * sizeof(struct ComplexF);
+   }
+   else
+   {
+      p->rplan = fft_real_plan_create(p->n, FFT_SIMD);
+      if (!p->rplan)
+         return -1;
+      // n reals and n/2 + 1 bins, then the plan's own scratch
+      bytes = (size_t)p->n * sizeof(double) +
+              ((size_t)p->n / 2 + 1 + fft_real_work_size(p->rplan)) *
+              sizeof(struct Complex);
+   }
+
+   if (p->batch > 1)
+      p->pool = fft_pool_create(0);
+   p->nslots = fft_pool_slots(p->pool);
+   tasks = p->nslots * 4;
+   p->frames_per_task = (p->batch + tasks - 1) / tasks;
+
+   p->scratch = calloc(p->nslots, sizeof(*p->scratch));
+   if (!p->scratch)
+      return -1;
+   for (i = 0; i < p->nslots; i++)
+   {
+      p->scratch[i] = malloc(bytes);
+      if (!p->scratch[i])
+         return -1;
+   }
+   return 0;
+}
+
+/* padded: the real side has the default layout, which is padded when the
+   plan is run in place. */
+static cufftResult make_plan(cufftHandle *handle, int n, cufftType type,
+                             int batch, int istride, int idist,
+                             int ostride, int odist, int padded)
+{
+   struct cufft_plan *p;
+   int h;
+
+   if (!handle)
+      return CUFFT_INVALID_VALUE;
+   if (type != CUFFT_C2C && type != CUFFT_Z2Z && type != CUFFT_R2C &&
+       type != CUFFT_D2Z && type != CUFFT_C2R && type != CUFFT_Z2D)
+      return CUFFT_INVALID_TYPE;
+   if (n < 1 || n > FFT_MAX_SIZE)
+      return CUFFT_INVALID_SIZE;
+   // The float engine only does powers of two, and the real types go
+   // through a half-length complex FFT.
+   if (type == CUFFT_C2C && (n & (n - 1)) != 0)
+      return CUFFT_INVALID_SIZE;
+   if (type != CUFFT_C2C && type != CUFFT_Z2Z && n % 2 != 0)
+      return CUFFT_INVALID_SIZE;
+   if (batch < 1 || istride < 1 || ostride < 1 || idist < 0 || odist < 0)
+      return CUFFT_INVALID_VALUE;
+
+   p = calloc(1, sizeof(*p));
+   if (!p)
+      return CUFFT_ALLOC_FAILED;
+   p->type = type;
+   p->n = n;
+   p->batch = batch;
+   p->istride = istride;
+   p->idist = idist;
+   p->ostride = ostride;
+   p->odist = odist;
+   p->inplace_idist = idist;
+   p->inplace_odist = odist;
+   if (padded && (type == CUFFT_R2C || type == CUFFT_D2Z))
+      p->inplace_idist = 2 * (n / 2 + 1);
+   if (padded && (type == CUFFT_C2R || type == CUFFT_Z2D))
+      p->inplace_odist = 2 * (n / 2 + 1);
+   if (type == CUFFT_Z2Z)
+   {
+      p->zbatch = fft_batch_plan_create(n, batch, istride, idist,
+                                        ostride, odist, FFT_SIMD, 0);
+      p->zbatch_inv = fft_batch_plan_create(n, batch, istride, idist,
+                                            ostride, odist,
+                                            FFT_SIMD | FFT_INVERSE, 0);
+      if (!p->zbatch || !p->zbatch_inv)
+      {
+         destroy_plan(p);
+         return CUFFT_ALLOC_FAILED;
+      }
+   }
+   else if (setup_frames(p) < 0)
+   {
+      destroy_plan(p);
+      return CUFFT_ALLOC_FAILED;
+   }
+
+   pthread_mutex_lock(&plans_lock);
+   for (h = 0; h < CUFFT_MAX_PLANS && plans[h]; h++)
+      ;
+   if (h < CUFFT_MAX_PLANS)
+      plans[h] = p;
+   pthread_mutex_unlock(&plans_lock);
+   if (h == CUFFT_MAX_PLANS)
+   {
+      destroy_plan(p);
+      return CUFFT_ALLOC_FAILED;
+   }
+   *handle = h;
+   return CUFFT_SUCCESS;
+}
+
+static struct cufft_plan *lookup(cufftHandle handle)
+{
+   struct cufft_plan *p = NULL;
+
+   if (handle >= 0 && handle < CUFFT_MAX_PLANS)
+   {
+      pthread_mutex_lock(&plans_lock);
+      p = plans[handle];
+      pthread_mutex_unlock(&plans_lock);
+   }
+   return p;
+}
+
+cufftResult cufftPlan1d(cufftHandle *plan, int nx, cufftType type, int batch)
+{
+   int in_len = nx, out_len = nx;
+
+   if (type == CUFFT_R2C || type == CUFFT_D2Z)
+      out_len = nx / 2 + 1;
+   if (type == CUFFT_C2R || type == CUFFT_Z2D)
+      in_len = nx / 2 + 1;
+   return make_plan(plan, nx, type, batch, 1, in_len, 1, out_len, 1);
+}
+
+cufftResult cufftPlanMany(cufftHandle *plan, int rank, int *n,
+                          int *inembed, int istride, int idist,
+                          int *onembed, int ostride, int odist,
+                          cufftType type, int batch)
+{
+   int nx;
+
+   if (rank != 1)
+      return CUFFT_NOT_SUPPORTED;
+   if (!n)
+      return CUFFT_INVALID_VALUE;
+   nx = n[0];
+   if (!inembed)
+   {
+      istride = 1;
+      idist = (type == CUFFT_C2R || type == CUFFT_Z2D) ? nx / 2 + 1 : nx;
+   }
+   if (!onembed)
+   {
+      ostride = 1;
+      odist = (type == CUFFT_R2C || type == CUFFT_D2Z) ? nx / 2 + 1 : nx;
+   }
+   return make_plan(plan, nx, type, batch, istride, idist, ostride, odist,
+                    (type == CUFFT_C2R || type == CUFFT_Z2D) ? !onembed :
+                                                               !inembed);
+}
+
+cufftResult cufftDestroy(cufftHandle plan)
+{
+   struct cufft_plan *p = NULL;
+
+   if (plan >= 0 && plan < CUFFT_MAX_PLANS)
+   {
+      pthread_mutex_lock(&plans_lock);
+      p = plans[plan];
+      plans[plan] = NULL;
+      pthread_mutex_unlock(&plans_lock);
+   }
+   if (!p)
+      return CUFFT_INVALID_PLAN;
+   destroy_plan(p);
+   return CUFFT_SUCCESS;
+}
+
+
+static void c2c_frame(const struct cufft_plan *p, const struct ComplexF *in,
+                      struct ComplexF *out, void *scratch, int inverse)
+{
+   const fftf_plan *plan = inverse ? p->cplan_inv : p->cplan;
+   struct ComplexF *buf = scratch;
+   struct ComplexF *work = buf + p->n;
+   int k;
+
+   if (p->istride == 1 && p->ostride == 1)
+      fftf_execute_work(plan, in, out, work);
+   else
+   {
+      for (k = 0; k < p->n; k++)
+         buf[k] = in[(size_t)k * p->istride];
+      fftf_execute_work(plan, buf, buf, work);
+      for (k = 0; k < p->n; k++)
+         out[(size_t)k * p->ostride] = buf[k];
+   }
+}
+
+static void r2c_frame(const struct cufft_plan *p, const void *in, void *out,
+                      void *scratch)
+{
+   double *x = scratch;
+   struct Complex *X = (struct Complex *)(x + p->n);
+   struct Complex *work = X + p->n / 2 + 1;
+   int k;
+
+   if (is_single(p->type))
+      for (k = 0; k < p->n; k++)
+         x[k] = ((const float *)in)[(size_t)k * p->istride];
+   else
+      for (k = 0; k < p->n; k++)
+         x[k] = ((const double *)in)[(size_t)k * p->istride];
+   fft_execute_r2c_work(p->rplan, x, X, work);
+   if (is_single(p->type))
+      for (k = 0; k <= p->n / 2; k++)
+      {
+         ((struct ComplexF *)out)[(size_t)k * p->ostride].a = X[k].a;
+         ((struct ComplexF *)out)[(size_t)k * p->ostride].b = X[k].b;
+      }
+   else
+      for (k = 0; k <= p->n / 2; k++)
+         ((struct Complex *)out)[(size_t)k * p->ostride] = X[k];
+}
+
+static void c2r_frame(const struct cufft_plan *p, const void *in, void *out,
+                      void *scratch)
+{
+   double *x = scratch;
+   struct Complex *X = (struct Complex *)(x + p->n);
+   struct Complex *work = X + p->n / 2 + 1;
+   int k;
+
+   if (is_single(p->type))
+      for (k = 0; k <= p->n / 2; k++)
+      {
+         X[k].a = ((const struct ComplexF *)in)[(size_t)k * p->istride].a;
+         X[k].b = ((const struct ComplexF *)in)[(size_t)k * p->istride].b;
+      }
+   else
+      for (k = 0; k <= p->n / 2; k++)
+         X[k] = ((const struct Complex *)in)[(size_t)k * p->istride];
+   fft_execute_c2r_work(p->rplan, X, x, work);
+   if (is_single(p->type))
+      for (k = 0; k < p->n; k++)
+         ((float *)out)[(size_t)k * p->ostride] = x[k];
+   else
+      for (k = 0; k < p->n; k++)
+         ((double *)out)[(size_t)k * p->ostride] = x[k];
+}
+
+static void frames_task(void *arg, int task, int slot)
+{
+   const struct cufft_job *job = arg;
+   const struct cufft_plan *p = job->plan;
+   size_t isize, osize;
+   int f, f0, f1;
+
+   f0 = task * p->frames_per_task;
+   f1 = f0 + p->frames_per_task < p->batch ? f0 + p->frames_per_task :
+                                             p->batch;
+
+   // Bytes per element on each side, for stepping between frames.
+   switch (p->type)
+   {
+   case CUFFT_C2C:
+      isize = osize = sizeof(struct ComplexF);
+      break;
+   case CUFFT_R2C:
+      isize = sizeof(float);
+      osize = sizeof(struct ComplexF);
+      break;
+   case CUFFT_C2R:
+      isize = sizeof(struct ComplexF);
+      osize = sizeof(float);
+      break;
+   case CUFFT_D2Z:
+      isize = sizeof(double);
+      osize = sizeof(struct Complex);
+      break;
+   default:
+      isize = sizeof(struct Complex);
+      osize = sizeof(double);
+      break;
+   }
+
+   for (f = f0; f < f1; f++)
+   {
+      const char *in = (const char *)job->in + (size_t)f * job->idist * isize;
+      char *out = (char *)job->out + (size_t)f * job->odist * osize;
+
+      if (p->type == CUFFT_C2C)
+         c2c_frame(p, (const struct ComplexF *)in, (struct ComplexF *)out,
+                   p->scratch[slot], job->inverse);
+      else if (p->type == CUFFT_R2C || p->type == CUFFT_D2Z)
+         r2c_frame(p, in, out, p->scratch[slot]);
+      else
+         c2r_frame(p, in, out, p->scratch[slot]);
+   }
+}
+
+static cufftResult run_frames(cufftHandle handle, cufftType type,
+                              const void *in, void *out, int inverse)
+{
+   struct cufft_plan *p = lookup(handle);
+   struct cufft_job job;
+
+   if (!p)
+      return CUFFT_INVALID_PLAN;
+   if (p->type != type)
+      return CUFFT_INVALID_TYPE;
+   if (!in || !out)
+      return CUFFT_INVALID_VALUE;
+   job.plan = p;
+   job.in = in;
+   job.out = out;
+   job.idist = in == out ? p->inplace_idist : p->idist;
+   job.odist = in == out ? p->inplace_odist : p->odist;
+   job.inverse = inverse;
+   fft_pool_run(p->pool, frames_task, &job,
+                (p->batch + p->frames_per_task - 1) / p->frames_per_task);
+   return CUFFT_SUCCESS;
+}
+
+cufftResult cufftExecC2C(cufftHandle plan, cufftComplex *idata,
+                         cufftComplex *odata, int direction)
+{
+   if (direction != CUFFT_FORWARD && direction != CUFFT_INVERSE)
+      return CUFFT_INVALID_VALUE;
+   return run_frames(plan, CUFFT_C2C, idata, odata,
+                     direction == CUFFT_INVERSE);
+}
+
+cufftResult cufftExecZ2Z(cufftHandle plan, cufftDoubleComplex *idata,
+                         cufftDoubleComplex *odata, int direction)
+{
+   struct cufft_plan *p = lookup(plan);
+
+   if (!p)
+      return CUFFT_INVALID_PLAN;
+   if (p->type != CUFFT_Z2Z)
+      return CUFFT_INVALID_TYPE;
+   if (!idata || !odata ||
+       (direction != CUFFT_FORWARD && direction != CUFFT_INVERSE))
+      return CUFFT_INVALID_VALUE;
+   fft_batch_execute(direction == CUFFT_INVERSE ? p->zbatch_inv : p->zbatch,
+                     (const struct Complex *)idata, (struct Complex *)odata);
+   return CUFFT_SUCCESS;
+}
+
+cufftResult cufftExecR2C(cufftHandle plan, cufftReal *idata,
+                         cufftComplex *odata)
+{
+   return run_frames(plan, CUFFT_R2C, idata, odata, 0);
+}
+
+cufftResult cufftExecD2Z(cufftHandle plan, cufftDoubleReal *idata,
+                         cufftDoubleComplex *odata)
+{
+   return run_frames(plan, CUFFT_D2Z, idata, odata, 0);
+}
+
+cufftResult cufftExecC2R(cufftHandle plan, cufftComplex *idata,
+                         cufftReal *odata)
+{
+   return run_frames(plan, CUFFT_C2R, idata, odata, 0);
+}
+
+cufftResult cufftExecZ2D(cufftHandle plan, cufftDoubleComplex *idata,
+                         cufftDoubleReal *odata)
+{
+   return run_frames(plan, CUFFT_Z2D, idata, odata, 0);
+}
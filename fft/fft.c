@@ -0,0 +1,629 @@
+/*
+ * fft.c
+ *
+ * Radix-2 decimation-in-frequency FFT for any power-of-two length.
+ *
+ * This is the FFT() routine that used to live in rohan_fft.c, taken off the
+ * global X[1024] array and the fixed M = 10 so that it works on caller
+ * buffers of any size from 1 to FFT_MAX_SIZE points.  Indexing is 0-based.
+ *
+ * Everything that only depends on the length is worked out once when the
+ * plan is made: the twiddle factors are evaluated directly with cos/sin
+ * (no recurrence, so no error build-up across a stage) and the bit-reversal
+ * is stored as a list of index pairs to swap.  fft_execute() then does no
+ * trig at all.
+ *
+ * These kernels share those tables:
+ *
+ *   FFT_RADIX2    the original in-place DIF loop followed by the bit-reversal
+ *                 swaps.  No extra memory, but the swaps jump all over the
+ *                 array, which hurts once n no longer fits in cache.
+ *   FFT_STOCKHAM  ping-pongs between the output and a work buffer of n
+ *                 points.  Each pass reads and writes with unit stride and
+ *                 the output comes out in natural order, so there is no
+ *                 reordering pass at all.
+ *   FFT_RADIX4    fuses pairs of radix-2 stages into one pass of radix-4
+ *                 butterflies (3 complex multiplies per 4 points instead of
+ *                 4), with one radix-2 pass first when log2(n) is odd.
+ *   FFT_SPLIT_RADIX  L-shaped split-radix butterflies, radix-2 on the even
+ *                 half and radix-4 on the odd quarters, which has the lowest
+ *                 flop count of the three.
+ *
+ *   FFT_SIMD      keeps the data as separate real and imaginary arrays in
+ *                 the work buffer so the butterflies map straight onto
+ *                 SSE2/AVX2/AVX-512 registers (fft_simd.c).  The caller's
+ *                 array of struct Complex is only read on the way in and
+ *                 written on the way out, with the bit-reversal folded into
+ *                 the write.
+ *   FFT_CODELET   fully unrolled code for each n from 64 to 4096, written
+ *                 by gen_codelets.c with the twiddles as constants, on the
+ *                 same vector units (fft_simd.c).  Other powers of two get
+ *                 FFT_SIMD.
+ *
+ * RADIX4 and SPLIT_RADIX are in place and arranged so that they leave the
+ * output in the same bit-reversed order as RADIX2, so all three finish with
+ * the same swap list.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft.h"
+#include "fft_internal.h"
+
+/* Given j = bitrev(i), returns bitrev(i + 1) for an n-point reversal. */
+static int next_reversed(int j, int n)
+{
+   int k = n / 2;
+   while (k >= 1 && k <= j)
+   {
+      j = j - k;
+      k = k / 2;
+   }
+   return j + k;
+}
+
+static int make_tables(fft_plan *plan)
+{
+   int n = plan->n;
+   int i, j, count = 0;
+
+   // Radix-4 and split-radix butterflies need W^3j as well as W^j, which
+   // reaches up to 3n/4.
+   plan->twiddle = malloc((3 * n / 4 + 1) * sizeof(*plan->twiddle));
+   if (!plan->twiddle)
+      return -1;
+   for (i = 0; i < 3 * n / 4; i++)
+   {
+      plan->twiddle[i].a = cos(2.0 * M_PI * i / n);
+      plan->twiddle[i].b = -sin(2.0 * M_PI * i / n);
+   }
+
+   for (i = 0, j = 0; i < n; i++, j = next_reversed(j, n))
+      if (i < j)
+         count++;
+   plan->swaps = malloc((2 * count + 1) * sizeof(*plan->swaps));
+   if (!plan->swaps)
+      return -1;
+   plan->nswaps = 0;
+   for (i = 0, j = 0; i < n; i++, j = next_reversed(j, n))
+   {
+      if (i < j)
+      {
+         plan->swaps[2 * plan->nswaps] = i;
+         plan->swaps[2 * plan->nswaps + 1] = j;
+         plan->nswaps++;
+      }
+   }
+   return 0;
+}
+
+int fft_simd_twiddles(double *twr, double *twi, int n)
+{
+   int LE, j, k, off = 0;
+
+   for (LE = n, k = 0; LE >= 16; LE /= 2)
+      k++;
+   LE = n;
+   if (k % 2)
+   {
+      for (j = 0; j < LE / 2; j++)
+      {
+         twr[off + j] = cos(2.0 * M_PI * j / LE);
+         twi[off + j] = -sin(2.0 * M_PI * j / LE);
+      }
+      off += LE / 2;
+      LE /= 2;
+   }
+   for (; LE >= 32; LE /= 4)
+   {
+      for (j = 0; j < LE / 4; j++)
+         for (k = 1; k <= 3; k++)
+         {
+            twr[off + (k - 1) * LE / 4 + j] = cos(2.0 * M_PI * k * j / LE);
+            twi[off + (k - 1) * LE / 4 + j] = -sin(2.0 * M_PI * k * j / LE);
+         }
+      off += 3 * LE / 4;
+   }
+   return off;
+}
+
+void fft_bit_reverse_table(int *rev, int n)
+{
+   int j, k;
+
+   for (j = 0, k = 0; j < n; j++, k = next_reversed(k, n))
+      rev[j] = k;
+}
+
+void fft_inverse_table(int *rev, int n)
+{
+   int j;
+
+   for (j = 0; j < n; j++)
+      rev[j] = (n - rev[j]) & (n - 1);
+}
+
+/* Split real/imaginary twiddles for fft_simd_dif() and the full
+   bit-reversal permutation used when writing the result out. */
+static int make_simd_tables(fft_plan *plan)
+{
+   int n = plan->n;
+
+   plan->simd_twr = malloc(n * sizeof(*plan->simd_twr));
+   plan->simd_twi = malloc(n * sizeof(*plan->simd_twi));
+   plan->rev = malloc(n * sizeof(*plan->rev));
+   if (!plan->simd_twr || !plan->simd_twi || !plan->rev)
+      return -1;
+   fft_simd_twiddles(plan->simd_twr, plan->simd_twi, n);
+   fft_bit_reverse_table(plan->rev, n);
+   if (plan->inverse)
+      fft_inverse_table(plan->rev, n);
+   return 0;
+}
+
+
+fft_plan *fft_plan_create(int n, int flags)
+{
+   return fft_plan_create_threaded(n, flags, 1);
+}
+
+fft_plan *fft_plan_create_threaded(int n, int flags, int nthreads)
+{
+   fft_plan *plan;
+   int m = 0;
+
+   if (n < 1 || n > FFT_MAX_SIZE)
+      return NULL;
+   if ((flags & FFT_KERNEL_MASK) > FFT_CODELET)
+      return NULL;
+   while ((1 << m) < n)
+      m++;
+   if ((flags & FFT_MEASURE) && (n & (n - 1)) == 0)
+   {
+      flags = fft_wisdom_flags(n, flags, &nthreads);
+      if (flags < 0)
+         return NULL;
+   }
+
+   plan = calloc(1, sizeof(*plan));
+   if (!plan)
+      return NULL;
+   plan->n = n;
+   plan->m = m;
+   plan->kernel = flags & FFT_KERNEL_MASK;
+   plan->inverse = (flags & FFT_INVERSE) != 0;
+   if ((n & (n - 1)) != 0 || plan->kernel == FFT_MIXED_RADIX ||
+       plan->kernel == FFT_BLUESTEIN)
+   {
+      if (fft_mixed_init(plan) < 0)
+      {
+         fft_plan_destroy(plan);
+         return NULL;
+      }
+      return plan;
+   }
+   if (plan->kernel == FFT_FOUR_STEP)
+   {
+      // The work is all in the row plans; no tables of our own.
+      if (fft_four_step_init(plan, flags, nthreads) < 0)
+      {
+         fft_plan_destroy(plan);
+         return NULL;
+      }
+      return plan;
+   }
+   if (plan->kernel == FFT_CODELET && (n < CODELET_MIN || n > CODELET_MAX))
+      plan->kernel = FFT_SIMD;
+   if (plan->kernel == FFT_SIMD || plan->kernel == FFT_CODELET)
+   {
+      plan->isa = fft_simd_best_isa();
+      if ((flags & FFT_ISA_MASK) > plan->isa)
+      {
+         // The CPU does not have the instruction set that was asked for.
+         free(plan);
+         return NULL;
+      }
+      if (flags & FFT_ISA_MASK)
+         plan->isa = flags & FFT_ISA_MASK;
+   }
+   if (plan->kernel == FFT_CODELET)
+      return plan;   // everything is built into the code
+   if (make_tables(plan) < 0 ||
+       (plan->kernel == FFT_SIMD && make_simd_tables(plan) < 0))
+   {
+      fft_plan_destroy(plan);
+      return NULL;
+   }
+   return plan;
+}
+
+void fft_plan_destroy(fft_plan *plan)
+{
+   if (!plan)
+      return;
+   if (plan->kernel == FFT_FOUR_STEP)
+      fft_four_step_free(plan);
+   if (plan->kernel == FFT_MIXED_RADIX || plan->kernel == FFT_BLUESTEIN)
+      fft_mixed_free(plan);
+   free(plan->twiddle);
+   free(plan->swaps);
+   free(plan->simd_twr);
+   free(plan->simd_twi);
+   free(plan->rev);
+   free(plan);
+}
+
+int fft_plan_size(const fft_plan *plan)
+{
+   return plan->n;
+}
+
+int fft_plan_flags(const fft_plan *plan)
+{
+   return plan->kernel | (plan->kernel == FFT_SIMD ||
+                          plan->kernel == FFT_CODELET ? plan->isa : 0);
+}
+
+int fft_work_size(const fft_plan *plan)
+{
+   if (plan->kernel == FFT_FOUR_STEP)
+      return fft_four_step_work_size(plan);
+   if (plan->kernel == FFT_MIXED_RADIX || plan->kernel == FFT_BLUESTEIN)
+      return fft_mixed_work_size(plan);
+   if (plan->kernel == FFT_STOCKHAM || plan->kernel == FFT_SIMD ||
+       plan->kernel == FFT_CODELET)
+      return plan->n;
+   return 0;
+}
+
+/* DIF leaves the output in bit-reversed order; put it back. */
+static void bit_reverse(const fft_plan *plan, struct Complex *X)
+{
+   const int *sw = plan->swaps;
+   struct Complex T;
+   int k, i, j;
+
+   for (k = 0; k < plan->nswaps; k++)
+   {
+      i = sw[2 * k];
+      j = sw[2 * k + 1];
+      T = X[j];
+      X[j] = X[i];
+      X[i] = T;
+   }
+}
+
+static void radix2_dif(const fft_plan *plan, struct Complex *X)
+{
+   const struct Complex *tw = plan->twiddle;
+   int N = plan->n;
+   struct Complex U, T, Tmp;
+   int i, j, k, IP;
+   int LE, LE1, step;
+
+   // Stage k uses every step-th entry of the twiddle table.  With the
+   // twiddles in a table the j loop no longer has to be the outer one, so
+   // each group of LE points is walked with unit stride.
+   for (k = 0, step = 1; k < plan->m; k++, step <<= 1)
+   {
+      LE = N >> k;
+      LE1 = LE / 2;
+      for (i = 0; i < N; i = i + LE)
+      {
+         for (j = 0; j < LE1; j++)
+         {
+            U = tw[j * step];
+            IP = i + j + LE1;
+            T.a = X[i + j].a + X[IP].a;
+            T.b = X[i + j].b + X[IP].b;
+            Tmp.a = X[i + j].a - X[IP].a;
+            Tmp.b = X[i + j].b - X[IP].b;
+            X[IP].a = (Tmp.a * U.a) - (Tmp.b * U.b);
+            X[IP].b = (Tmp.a * U.b) + (Tmp.b * U.a);
+            X[i + j].a = T.a;
+            X[i + j].b = T.b;
+         }
+      }
+   }
+
+   bit_reverse(plan, X);
+}
+
+/* Radix-4 DIF.  Each pass does the work of two radix-2 passes: for a
+   group of LE points and q = LE/4,
+
+      y0 = (x0 + x2) + (x1 + x3)
+      y1 = ((x0 + x2) - (x1 + x3)) W^2j
+      y2 = ((x0 - x2) - i(x1 - x3)) W^j
+      y3 = ((x0 - x2) + i(x1 - x3)) W^3j
+
+   with W = e^(-i*2*pi/LE), which is exactly what two radix-2 passes would
+   have left in those four slots, so the output order is unchanged. */
+static void radix4_dif(const fft_plan *plan, struct Complex *X)
+{
+   const struct Complex *tw = plan->twiddle;
+   int N = plan->n;
+   struct Complex T, U, A, B, C, D;
+   int i, j, k, LE, q, step;
+   struct Complex *x0, *x1, *x2, *x3;
+
+   k = 0;
+   step = 1;
+   if (plan->m % 2)
+   {
+      // Odd log2(n): one radix-2 pass over the whole array first.
+      for (j = 0; j < N / 2; j++)
+      {
+         U = tw[j];
+         T.a = X[j].a - X[j + N / 2].a;
+         T.b = X[j].b - X[j + N / 2].b;
+         X[j].a = X[j].a + X[j + N / 2].a;
+         X[j].b = X[j].b + X[j + N / 2].b;
+         X[j + N / 2].a = (T.a * U.a) - (T.b * U.b);
+         X[j + N / 2].b = (T.a * U.b) + (T.b * U.a);
+      }
+      k = 1;
+      step = 2;
+   }
+
+   for (; k < plan->m; k += 2, step <<= 2)
+   {
+      LE = N >> k;
+      q = LE / 4;
+      for (i = 0; i < N; i = i + LE)
+      {
+         x0 = X + i;
+         x1 = x0 + q;
+         x2 = x1 + q;
+         x3 = x2 + q;
+         for (j = 0; j < q; j++)
+         {
+            A.a = x0[j].a + x2[j].a;     // x0 + x2
+            A.b = x0[j].b + x2[j].b;
+            B.a = x0[j].a - x2[j].a;     // x0 - x2
+            B.b = x0[j].b - x2[j].b;
+            C.a = x1[j].a + x3[j].a;     // x1 + x3
+            C.b = x1[j].b + x3[j].b;
+            D.a = x1[j].b - x3[j].b;     // -i(x1 - x3)
+            D.b = x3[j].a - x1[j].a;
+
+            x0[j].a = A.a + C.a;
+            x0[j].b = A.b + C.b;
+
+            T.a = A.a - C.a;
+            T.b = A.b - C.b;
+            U = tw[2 * j * step];
+            x1[j].a = (T.a * U.a) - (T.b * U.b);
+            x1[j].b = (T.a * U.b) + (T.b * U.a);
+
+            T.a = B.a + D.a;
+            T.b = B.b + D.b;
+            U = tw[j * step];
+            x2[j].a = (T.a * U.a) - (T.b * U.b);
+            x2[j].b = (T.a * U.b) + (T.b * U.a);
+
+            T.a = B.a - D.a;
+            T.b = B.b - D.b;
+            U = tw[3 * j * step];
+            x3[j].a = (T.a * U.a) - (T.b * U.b);
+            x3[j].b = (T.a * U.b) + (T.b * U.a);
+         }
+      }
+   }
+   bit_reverse(plan, X);
+}
+
+/* Split-radix DIF on the LE points at X, where step = n/LE.  The first
+   half becomes the even outputs and is split again as an LE/2 block; the
+   two odd quarters get the radix-4 treatment and become LE/4 blocks:
+
+      X[0..LE/2)      x0 + x2, x1 + x3
+      X[LE/2..3LE/4)  ((x0 - x2) - i(x1 - x3)) W^j
+      X[3LE/4..LE)    ((x0 - x2) + i(x1 - x3)) W^3j
+
+   The three sub-blocks are done depth first, so once a block fits in cache
+   everything below it stays there. */
+static void split_radix_block(struct Complex *X, int LE,
+                              const struct Complex *tw, int step)
+{
+   struct Complex T, U, B, D;
+   struct Complex *x0, *x1, *x2, *x3;
+   int j, q;
+
+   if (LE == 1)
+      return;
+   if (LE == 2)
+   {
+      T.a = X[0].a - X[1].a;
+      T.b = X[0].b - X[1].b;
+      X[0].a = X[0].a + X[1].a;
+      X[0].b = X[0].b + X[1].b;
+      X[1] = T;
+      return;
+   }
+
+   q = LE / 4;
+   x0 = X;
+   x1 = x0 + q;
+   x2 = x1 + q;
+   x3 = x2 + q;
+   for (j = 0; j < q; j++)
+   {
+      B.a = x0[j].a - x2[j].a;     // x0 - x2
+      B.b = x0[j].b - x2[j].b;
+      D.a = x1[j].b - x3[j].b;     // -i(x1 - x3)
+      D.b = x3[j].a - x1[j].a;
+      x0[j].a = x0[j].a + x2[j].a;
+      x0[j].b = x0[j].b + x2[j].b;
+      x1[j].a = x1[j].a + x3[j].a;
+      x1[j].b = x1[j].b + x3[j].b;
+
+      T.a = B.a + D.a;
+      T.b = B.b + D.b;
+      U = tw[j * step];
+      x2[j].a = (T.a * U.a) - (T.b * U.b);
+      x2[j].b = (T.a * U.b) + (T.b * U.a);
+
+      T.a = B.a - D.a;
+      T.b = B.b - D.b;
+      U = tw[3 * j * step];
+      x3[j].a = (T.a * U.a) - (T.b * U.b);
+      x3[j].b = (T.a * U.b) + (T.b * U.a);
+   }
+
+   split_radix_block(x0, LE / 2, tw, step * 2);
+   split_radix_block(x2, LE / 4, tw, step * 4);
+   split_radix_block(x3, LE / 4, tw, step * 4);
+}
+
+static void split_radix(const fft_plan *plan, struct Complex *X)
+{
+   split_radix_block(X, plan->n, plan->twiddle, 1);
+   bit_reverse(plan, X);
+}
+
+/* Radix-2 Stockham autosort.  Pass k reads x[q + s*p] and x[q + s*(p+m)]
+   and writes y[q + s*2p] and y[q + s*(2p+1)], where s = 2^k and m = n/(2s),
+   so both sides are streamed in order and the result ends up sorted. */
+static void stockham(const fft_plan *plan, const struct Complex *in,
+                     struct Complex *out, struct Complex *work)
+{
+   const struct Complex *tw = plan->twiddle;
+   const struct Complex *x;
+   struct Complex *y;
+   struct Complex U, A, B;
+   int N = plan->n;
+   int p, q, s, m;
+
+   if (N == 1)
+   {
+      out[0] = in[0];
+      return;
+   }
+
+   // The passes alternate between out and work; start with whichever
+   // makes the last pass land in out.  The first pass reads straight from
+   // in unless that would mean reading and writing the same buffer.
+   y = (plan->m % 2) ? out : work;
+   x = in;
+   if (x == y)
+   {
+      memcpy(work, in, N * sizeof(*work));
+      x = work;
+   }
+
+   for (s = 1, m = N / 2; m >= 1; s <<= 1, m >>= 1)
+   {
+      for (p = 0; p < m; p++)
+      {
+         U = tw[p * s];
+         for (q = 0; q < s; q++)
+         {
+            A = x[q + s * p];
+            B = x[q + s * (p + m)];
+            y[q + s * 2 * p].a = A.a + B.a;
+            y[q + s * 2 * p].b = A.b + B.b;
+            A.a = A.a - B.a;
+            A.b = A.b - B.b;
+            y[q + s * (2 * p + 1)].a = (A.a * U.a) - (A.b * U.b);
+            y[q + s * (2 * p + 1)].b = (A.a * U.b) + (A.b * U.a);
+         }
+      }
+      x = y;
+      y = (y == out) ? work : out;
+   }
+}
+
+/* FFT_SIMD: split the input into real and imaginary arrays in work, run
+   the vector passes down to LE = 16, then finish the 8-point blocks with
+   fft_simd_dif8(), which writes the result back interleaved and in
+   natural order. */
+static void simd_execute(const fft_plan *plan, const struct Complex *in,
+                         struct Complex *out, struct Complex *work)
+{
+   int N = plan->n;
+   double *re = (double *)work;
+   double *im = re + N;
+
+   fft_simd_split(plan->isa, in, re, im, N);
+   fft_simd_dif(plan->isa, re, im, N, plan->simd_twr, plan->simd_twi);
+   fft_simd_dif8(plan->isa, re, im, N, out, plan->rev);
+}
+
+/* For kernels that only know the forward transform: X^-1[k] = X[n - k]. */
+static void reverse_bins(struct Complex *X, int n)
+{
+   struct Complex t;
+   int k;
+
+   for (k = 1; k < n - k; k++)
+   {
+      t = X[k];
+      X[k] = X[n - k];
+      X[n - k] = t;
+   }
+}
+
+void fft_execute_work(const fft_plan *plan, const struct Complex *in,
+                      struct Complex *out, struct Complex *work)
+{
+   // These handle FFT_INVERSE themselves, through the rev table, the
+   // twiddles and a generated inverse of each codelet.
+   if (plan->kernel == FFT_FOUR_STEP)
+   {
+      fft_four_step_execute(plan, in, out, work);
+      return;
+   }
+   if (plan->kernel == FFT_SIMD && plan->n >= 16)
+   {
+      simd_execute(plan, in, out, work);
+      return;
+   }
+   if (plan->kernel == FFT_CODELET)
+   {
+      fft_simd_codelet(plan->isa, plan->n, plan->inverse, in, out,
+                       (double *)work);
+      return;
+   }
+
+   if (plan->kernel == FFT_STOCKHAM)
+      stockham(plan, in, out, work);
+   else if (plan->kernel == FFT_MIXED_RADIX || plan->kernel == FFT_BLUESTEIN)
+      fft_mixed_execute(plan, in, out, work);
+   else
+   {
+      if (in != out)
+         memcpy(out, in, plan->n * sizeof(*out));
+      switch (plan->kernel)
+      {
+      case FFT_RADIX4:
+         radix4_dif(plan, out);
+         break;
+      case FFT_SPLIT_RADIX:
+         split_radix(plan, out);
+         break;
+      default:
+         radix2_dif(plan, out);
+         break;
+      }
+   }
+   if (plan->inverse)
+      reverse_bins(out, plan->n);
+}
+
+int fft_execute(const fft_plan *plan, const struct Complex *in,
+                struct Complex *out)
+{
+   struct Complex *work = NULL;
+
+   if (fft_work_size(plan) > 0)
+   {
+      work = malloc(fft_work_size(plan) * sizeof(*work));
+      if (!work)
+         return -1;
+   }
+   fft_execute_work(plan, in, out, work);
+   free(work);
+   return 0;
+}
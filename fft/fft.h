@@ -0,0 +1,413 @@
+/*
+ * fft.h
+ *
+ * Plan/execute interface to the FFT engine used by rohan_fft.c.
+ *
+ * A plan is created once for a given length and may then be executed on
+ * any number of caller-owned buffers.  After fft_plan_create() returns, a
+ * plan is never written to again, so the same plan can be shared by
+ * several threads as long as each thread transforms its own buffers.
+ *
+ * The forward transform is unnormalised and uses the e^(-i*2*pi*k*n/N)
+ * kernel, matching the original FFT() routine.
+ */
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+struct Complex
+{  double a; //Real Part
+   double b; //Imaginary Part
+};
+
+#define FFT_MAX_LOG2N 26
+#define FFT_MAX_SIZE  (1 << FFT_MAX_LOG2N)
+
+/* Kernel selection, passed in the flags of fft_plan_create(). */
+#define FFT_RADIX2      0x0   // in-place radix-2 DIF plus bit-reversal pass
+#define FFT_STOCKHAM    0x1   // Stockham autosort, needs a work buffer
+#define FFT_RADIX4      0x2   // in-place radix-4 (radix-2 pass for odd log2 n)
+#define FFT_SPLIT_RADIX 0x3   // in-place split-radix
+#define FFT_SIMD        0x4   // split real/imaginary, vectorised, needs work
+#define FFT_FOUR_STEP   0x5   // rows and transposes for large n, threaded
+#define FFT_MIXED_RADIX 0x6   // radix 2, 3, 4, 5 and 7 passes, needs work
+#define FFT_BLUESTEIN   0x7   // chirp-z, any n up to FFT_MAX_SIZE / 2
+#define FFT_CODELET     0x8   // straight-line code for n = 64..4096, needs
+                              // work; FFT_SIMD for other powers of two
+#define FFT_KERNEL_MASK 0xf
+
+/* With FFT_SIMD, FFT_CODELET or FFT_FOUR_STEP, the widest instruction set
+   to use.  Leaving these out picks the best one the CPU supports when the
+   plan is made. */
+#define FFT_ISA_SSE2    0x10
+#define FFT_ISA_AVX2    0x20
+#define FFT_ISA_AVX512  0x30
+#define FFT_ISA_MASK    0x30
+
+/* Makes the plan compute the inverse transform, with e^(+i*2*pi*k*n/N)
+   and no 1/N scaling, so inverse(forward(x)) = N*x.  Accepted by
+   fft_plan_create(), fft_batch_plan_create() and fftf_plan_create(); the
+   real transforms pick their direction by which execute call is used. */
+#define FFT_INVERSE     0x100
+
+/* Makes fft_plan_create() time the power-of-two kernels, each instruction
+   set the CPU has and, for long transforms, FFT_FOUR_STEP on up to
+   nthreads threads, and use whichever is fastest on this host instead of
+   the kernel in flags.  The answer is kept as wisdom (fft_wisdom.c), so
+   only the first plan of each size and direction pays for the timing:
+   about 40 ms at n = 1024, under two seconds at n = 2^20.  Other lengths
+   ignore it. */
+#define FFT_MEASURE     0x200
+
+typedef struct fft_plan fft_plan;
+
+/* Creates a plan for an n-point transform, 1 <= n <= FFT_MAX_SIZE; flags
+   picks the kernel.  The power-of-two kernels are only used when n is a
+   power of two.  Any other n gets FFT_MIXED_RADIX if its prime factors
+   are all 2, 3, 5 or 7 and FFT_BLUESTEIN if not, whatever kernel was
+   asked for.  FFT_BLUESTEIN works through FFTs of at least 2n - 1
+   points, so it only goes up to n = FFT_MAX_SIZE / 2.  Returns NULL on a
+   bad size (including an n above that which needs FFT_BLUESTEIN) or when
+   out of memory. */
+fft_plan *fft_plan_create(int n, int flags);
+
+/* Same, with FFT_FOUR_STEP spread over nthreads threads (0 for one per
+   CPU, 1 to stay on the caller); other kernels ignore nthreads.  A plan
+   with threads owns them, so unlike the others it must not be executed
+   from two threads at once.  FFT_FOUR_STEP needs a larger work buffer,
+   see fft_work_size(). */
+fft_plan *fft_plan_create_threaded(int n, int flags, int nthreads);
+
+/* Transforms n points from in into out.  in and out may be the same
+   buffer, in which case the transform is done in place.  Any scratch
+   space the kernel needs is allocated for the call; returns -1 if that
+   fails, 0 otherwise. */
+int fft_execute(const fft_plan *plan, const struct Complex *in,
+                struct Complex *out);
+
+/* Number of struct Complex elements of scratch the plan needs. */
+int fft_work_size(const fft_plan *plan);
+
+/* Same as fft_execute() but with caller-provided scratch of at least
+   fft_work_size() elements, for loops that run the same plan many times.
+   work may be NULL when fft_work_size() is 0. */
+void fft_execute_work(const fft_plan *plan, const struct Complex *in,
+                      struct Complex *out, struct Complex *work);
+
+/* Length the plan was created for. */
+int fft_plan_size(const fft_plan *plan);
+
+/* Kernel the plan runs, with its FFT_ISA_* value for FFT_SIMD and
+   FFT_CODELET, e.g. to see what FFT_MEASURE or a non-power-of-two length
+   picked. */
+int fft_plan_flags(const fft_plan *plan);
+
+void fft_plan_destroy(fft_plan *plan);
+
+/* Wisdom gathered by FFT_MEASURE plans, saved to and loaded from a text
+   file so that later runs start with the tuned kernels instead of timing
+   them again.  fft_wisdom_load() adds the file's entries to what is
+   already known and returns how many it read, or -1 if the file cannot be
+   opened; fft_wisdom_save() writes everything known and returns 0, or -1
+   on failure.  fft_wisdom_forget() drops it all. */
+int fft_wisdom_load(const char *path);
+int fft_wisdom_save(const char *path);
+void fft_wisdom_forget(void);
+
+/* Real-input transforms (fft_real.c).  An n-point real transform, n even
+   and from 2 to FFT_MAX_SIZE, produces the n/2 + 1 bins
+   X[0..n/2]; the rest are the complex conjugates of those.  flags picks
+   the kernel of the n/2-point complex FFT used inside.  The c2r direction
+   is unnormalised like the complex one, so c2r(r2c(x)) = n*x. */
+typedef struct fft_real_plan fft_real_plan;
+
+fft_real_plan *fft_real_plan_create(int n, int flags);
+void fft_real_plan_destroy(fft_real_plan *plan);
+
+/* n real samples in, n/2 + 1 complex bins out, and the other way round.
+   Return -1 if scratch space cannot be allocated. */
+int fft_execute_r2c(const fft_real_plan *plan, const double *in,
+                    struct Complex *out);
+int fft_execute_c2r(const fft_real_plan *plan, const struct Complex *in,
+                    double *out);
+
+/* As above with caller scratch of fft_real_work_size() elements.  in is
+   left untouched. */
+int fft_real_work_size(const fft_real_plan *plan);
+void fft_execute_r2c_work(const fft_real_plan *plan, const double *in,
+                          struct Complex *out, struct Complex *work);
+
+/* r2c of in[i] * window[i], the window applied as the samples are packed
+   for the half-length FFT instead of in a pass of its own.  window holds
+   n values, e.g. fft_window_get()->w, or is NULL for none. */
+void fft_execute_r2c_window_work(const fft_real_plan *plan, const double *in,
+                                 const double *window, struct Complex *out,
+                                 struct Complex *work);
+void fft_execute_c2r_work(const fft_real_plan *plan, const struct Complex *in,
+                          double *out, struct Complex *work);
+
+/* Streaming FIR filter by FFT convolution (fft_conv.c): out = h * in over
+   an unbroken stream fed in blocks, as if by
+   out[i] = sum over j < taps of h[j] * in[i - j], with in = 0 before the
+   first block.  block is the number of samples per fft_conv_process()
+   call, or 0 to pick one that suits the filter length (read it back with
+   fft_conv_block_size()).  method is FFT_CONV_OLA for overlap-add or
+   FFT_CONV_OLS for overlap-save; both give the same result.  The filter
+   spectrum is computed once by fft_conv_create().  A filter carries the
+   stream's history, so each stream needs its own. */
+#define FFT_CONV_OLA 0
+#define FFT_CONV_OLS 1
+
+typedef struct fft_conv fft_conv;
+
+fft_conv *fft_conv_create(const double *h, int taps, int block, int method);
+void fft_conv_destroy(fft_conv *conv);
+int fft_conv_block_size(const fft_conv *conv);
+int fft_conv_fft_size(const fft_conv *conv);
+
+/* Filters the next block samples of the stream from in into out.  in and
+   out may be the same array. */
+void fft_conv_process(fft_conv *conv, const double *in, double *out);
+
+/* Forgets the history, to start a new stream. */
+void fft_conv_reset(fft_conv *conv);
+
+/* Window functions (fft_window.c), in the periodic form a DFT frame
+   wants.  fft_window_get() returns the table of n points, computed on the
+   first call for that window, n and beta and shared from then on, or NULL
+   on a bad type or size or when out of memory; it is never freed.  beta
+   is only used by FFT_WINDOW_KAISER, where 0 picks a default of 8.6.
+
+   A windowed spectrum reads low by the coherent gain, mean(w), for a tone
+   in the middle of a bin, so |X[k]| / (n * coherent_gain) is the tone's
+   amplitude again.  Noise is spread over enbw bins (the equivalent noise
+   bandwidth, n sum(w^2) / sum(w)^2), so a noise power per bin divides by
+   that as well to become a power per bin width. */
+#define FFT_WINDOW_RECT            0
+#define FFT_WINDOW_HANN            1
+#define FFT_WINDOW_HAMMING         2
+#define FFT_WINDOW_BLACKMAN        3
+#define FFT_WINDOW_BLACKMAN_HARRIS 4   // 4-term, -92 dB sidelobes
+#define FFT_WINDOW_FLATTOP         5   // amplitude error < 0.01 dB
+#define FFT_WINDOW_KAISER          6
+
+struct fft_window
+{
+   int type;                  // FFT_WINDOW_*
+   int n;
+   double beta;               // Kaiser only, 0 for the others
+   const double *w;           // w[i], i < n
+   double coherent_gain;      // sum(w) / n
+   double enbw;               // in bins
+};
+
+const struct fft_window *fft_window_get(int type, int n, double beta);
+
+/* Short-time Fourier transform (fft_stft.c) for spectrograms: frames of
+   n samples (n even), hop samples apart, each multiplied by
+   the window and transformed, giving n/2 + 1 magnitudes |X[k]| / n per
+   frame.  Samples are fed in chunks of any size; a frame is produced as
+   soon as its last sample arrives.  window is one of FFT_WINDOW_*, a
+   Kaiser window getting the default beta. */
+typedef struct fft_stft fft_stft;
+
+fft_stft *fft_stft_create(int n, int hop, int window);
+void fft_stft_destroy(fft_stft *stft);
+int fft_stft_bins(const fft_stft *stft);
+
+/* Most frames the next count samples can produce, for sizing out. */
+int fft_stft_max_frames(const fft_stft *stft, int count);
+
+/* Feeds count samples and writes fft_stft_bins() floats to out for every
+   frame they complete, one frame after another.  Returns the number of
+   frames written. */
+int fft_stft_process(fft_stft *stft, const double *in, int count,
+                     float *out);
+
+/* Drops buffered samples, to start a new stream. */
+void fft_stft_reset(fft_stft *stft);
+
+/* Goertzel filter bank (fft_goertzel.c) for monitoring a few bins: for
+   each n-sample real frame, out[i] = X[bins[i]] as the real FFT would give
+   it, 0 <= bins[i] <= n/2.  Each bin costs O(n), so for a handful of bins
+   this is cheaper than the whole spectrum.  method is FFT_GOERTZEL_FILTER
+   to always filter, FFT_GOERTZEL_FFT to always take one real FFT (n even)
+   and pick the bins out, or FFT_GOERTZEL_AUTO to use whichever is cheaper
+   for nbins bins of n points.  A bank keeps scratch, so each thread needs
+   its own. */
+#define FFT_GOERTZEL_AUTO   0
+#define FFT_GOERTZEL_FILTER 1
+#define FFT_GOERTZEL_FFT    2
+
+typedef struct fft_goertzel fft_goertzel;
+
+fft_goertzel *fft_goertzel_create(int n, const int *bins, int nbins,
+                                  int method);
+void fft_goertzel_destroy(fft_goertzel *g);
+
+/* 1 if the bank runs an FFT rather than the filters. */
+int fft_goertzel_uses_fft(const fft_goertzel *g);
+
+/* n samples in, nbins bins out. */
+void fft_goertzel_process(fft_goertzel *g, const double *x,
+                          struct Complex *out);
+
+/* Sliding DFT (fft_sdft.c): the spectrum of the last n samples of a
+   stream, updated on every sample at the cost of one complex multiply per
+   bin, so O(n) for all of them or O(1) for each of a few.  bins lists the
+   bins to track (0..n/2), or is NULL for all n/2 + 1 of them, in which case
+   nbins is ignored.  Every anchor samples (0 for every n) the bins are
+   recomputed from the window to stop rounding errors building up.  Before
+   n samples have come in, the window is padded with zeros in front.  An
+   sdft carries the stream's history, so each stream needs its own. */
+typedef struct fft_sdft fft_sdft;
+
+fft_sdft *fft_sdft_create(int n, const int *bins, int nbins, int anchor);
+void fft_sdft_destroy(fft_sdft *s);
+int fft_sdft_bins(const fft_sdft *s);
+
+/* Slides the window over the next count samples. */
+void fft_sdft_process(fft_sdft *s, const double *in, int count);
+
+/* Current value of each tracked bin, fft_sdft_bins() of them, in the order
+   they were given. */
+void fft_sdft_spectrum(const fft_sdft *s, struct Complex *out);
+
+/* Empties the window, to start a new stream. */
+void fft_sdft_reset(fft_sdft *s);
+
+/* Batched transforms (fft_batch.c), laid out like cufftPlanMany(): howmany
+   frames of n points, where point k of frame f is in[f*idist + k*istride]
+   and its result goes to out[f*odist + k*ostride].  flags picks the kernel
+   for long frames; frames of up to 128 points are always done 8 at a time
+   across vector lanes.  The frames are split over nthreads threads (0 for
+   one per CPU, 1 to stay on the caller).  in and out may be the same
+   array if they use the same layout.
+
+   A batch plan owns its threads and scratch, so unlike fft_plan it must
+   not be executed from two threads at once. */
+typedef struct fft_batch_plan fft_batch_plan;
+
+fft_batch_plan *fft_batch_plan_create(int n, int howmany,
+                                      int istride, int idist,
+                                      int ostride, int odist,
+                                      int flags, int nthreads);
+void fft_batch_execute(fft_batch_plan *plan, const struct Complex *in,
+                       struct Complex *out);
+void fft_batch_plan_destroy(fft_batch_plan *plan);
+
+/* Multi-channel real transforms (fft_multi.c) for boards that sample
+   several channels at once: n samples (n even) of each of channels
+   channels, interleaved so that sample t of channel c is
+   in[t*channels + c], give the n/2 + 1 bins of each channel in
+   out[c*(n/2 + 1) + k] and, if mag is not NULL, the magnitudes
+   |X[k]| / n in mag laid out the same way.  The block is de-interleaved
+   in one pass and the channels are transformed on nthreads threads (0 for
+   one per CPU, 1 to stay on the caller).  flags picks the kernel as for
+   fft_real_plan_create().  A plan owns its threads and scratch, so it
+   must not be executed from two threads at once. */
+typedef struct fft_multi_plan fft_multi_plan;
+
+fft_multi_plan *fft_multi_plan_create(int n, int channels, int flags,
+                                      int nthreads);
+void fft_multi_plan_destroy(fft_multi_plan *plan);
+int fft_multi_channels(const fft_multi_plan *plan);
+void fft_multi_execute(fft_multi_plan *plan, const double *in,
+                       struct Complex *out, float *mag);
+
+/* Two-dimensional transforms (fft_2d.c) of ny rows of nx points, stored
+   row by row, any sizes with nx * ny <= FFT_MAX_SIZE.  The rows
+   and columns are split over nthreads threads (0 for one per CPU, 1 to
+   stay on the caller); a plan with threads must not be executed from two
+   threads at once.  inverse = 1 runs the inverse transform, unnormalised,
+   so a forward then inverse transform returns nx * ny times the input.
+   in and out may be the same buffer. */
+typedef struct fft_2d_plan fft_2d_plan;
+
+fft_2d_plan *fft_2d_plan_create(int nx, int ny, int nthreads);
+void fft_2d_plan_destroy(fft_2d_plan *plan);
+int fft_2d_width(const fft_2d_plan *plan);
+int fft_2d_height(const fft_2d_plan *plan);
+
+/* Returns -1 if scratch space cannot be allocated. */
+int fft_2d_execute(const fft_2d_plan *plan, const struct Complex *in,
+                   struct Complex *out, int inverse);
+int fft_2d_work_size(const fft_2d_plan *plan);
+void fft_2d_execute_work(const fft_2d_plan *plan, const struct Complex *in,
+                         struct Complex *out, int inverse,
+                         struct Complex *work);
+
+/* Fill an nx * ny plane from a width x height image, zero padding on the
+   right and at the top and cropping anything past nx x ny.  rgb is 3
+   bytes a pixel, laid out like the data ImageLoad() returns; channel is
+   0, 1 or 2 for red, green or blue, or FFT_2D_GRAY for the luminance
+   0.299 R + 0.587 G + 0.114 B.  plane is one float a pixel. */
+#define FFT_2D_GRAY -1
+
+void fft_2d_load_pixels(const fft_2d_plan *plan, const char *rgb,
+                        int width, int height, int channel,
+                        struct Complex *out);
+void fft_2d_load_plane(const fft_2d_plan *plan, const float *plane,
+                       int width, int height, struct Complex *out);
+
+/* The way back: writes the real part of in times scale, rounded and
+   clamped to 0..255, into one channel of rgb (all three for
+   FFT_2D_GRAY).  Pass scale = 1.0 / (nx * ny) after an inverse transform. */
+void fft_2d_store_pixels(const fft_2d_plan *plan, const struct Complex *in,
+                         double scale, char *rgb, int width, int height,
+                         int channel);
+
+/* Single-precision complex transforms (fft_float.c).  Same sizes and
+   conventions as fft_plan; flags may hold one of the FFT_ISA_* limits.
+   Always uses the vectorised split real/imaginary kernel, so it needs n
+   elements of scratch.
+
+   Error against the double engine, relative to the rms of the spectrum, is
+   about 1.1e-7 rms at n = 1024 and grows like sqrt(log2(n)) (1.3e-7 at
+   n = 16384).  The largest single-bin error is under 1e-7 of the peak bin.
+   12-bit ADC data only needs 2.4e-4. */
+struct ComplexF
+{  float a; //Real Part
+   float b; //Imaginary Part
+};
+
+typedef struct fftf_plan fftf_plan;
+
+fftf_plan *fftf_plan_create(int n, int flags);
+void fftf_plan_destroy(fftf_plan *plan);
+int fftf_execute(const fftf_plan *plan, const struct ComplexF *in,
+                 struct ComplexF *out);
+int fftf_work_size(const fftf_plan *plan);
+void fftf_execute_work(const fftf_plan *plan, const struct ComplexF *in,
+                       struct ComplexF *out, struct ComplexF *work);
+
+/* Fixed-point complex transforms (fft_fixed.c), for integer data such as
+   raw ADC counts.  n must be a power of two; flags may hold FFT_INVERSE.
+   The transform scales itself (block floating point): the execute calls
+   return an exponent e, and the spectrum of in is out * 2^e.  Neither
+   call needs scratch, and in and out may be the same array.
+
+   One plan serves both precisions.  On 12-bit ADC data at n = 1024 the
+   Q15 spectrum is about 55 dB above its error against the double engine,
+   3 dB less each time n doubles, and the Q31 one about 150 dB. */
+struct ComplexQ15
+{  int16_t a; //Real Part
+   int16_t b; //Imaginary Part
+};
+
+struct ComplexQ31
+{  int32_t a; //Real Part
+   int32_t b; //Imaginary Part
+};
+
+typedef struct fft_fixed_plan fft_fixed_plan;
+
+fft_fixed_plan *fft_fixed_plan_create(int n, int flags);
+void fft_fixed_plan_destroy(fft_fixed_plan *plan);
+int fft_execute_q15(const fft_fixed_plan *plan, const struct ComplexQ15 *in,
+                    struct ComplexQ15 *out);
+int fft_execute_q31(const fft_fixed_plan *plan, const struct ComplexQ31 *in,
+                    struct ComplexQ31 *out);
+
+#endif
@@ -0,0 +1,307 @@
+/*
+ * fft_2d.c
+ *
+ * Two-dimensional transforms of ny x nx row-major planes, such as the
+ * pixel data ImageLoad() returns.
+ *
+ * The transform is done as
+ *
+ *   1. an nx-point FFT of every row, in -> out
+ *   2. a tiled transpose, out -> work, so the columns become rows
+ *   3. an ny-point FFT of every row of work, in place
+ *   4. a tiled transpose back, work -> out
+ *
+ * so both 1D passes run over contiguous rows and the strided accesses are
+ * confined to the transposes, which move a 32 x 32 tile at a time.  Rows
+ * and tiles are independent and each step is spread over the plan's
+ * thread pool.
+ *
+ * The inverse uses conj(FFT(conj(x))): the conjugate is taken as each row
+ * is loaded in step 1 and again as step 4 writes the result.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fft_internal.h"
+
+#define TILE 32   // 32x32 complex doubles = 16 KB per tile
+
+struct fft_2d_plan
+{
+   int nx, ny;
+   fft_plan *rows;            // FFT_SIMD, nx points
+   fft_plan *cols;            // FFT_SIMD, ny points
+   fft_pool *pool;
+   int nslots;
+   int slot_size;             // struct Complex elements of scratch per slot
+};
+
+struct fft_2d_job
+{
+   const fft_2d_plan *plan;
+   int stage;
+   int inverse;
+   const struct Complex *in;
+   struct Complex *out;
+   struct Complex *work;
+};
+
+enum { STAGE_ROWS, STAGE_TRANSPOSE_OUT, STAGE_COLS, STAGE_TRANSPOSE_BACK };
+
+
+fft_2d_plan *fft_2d_plan_create(int nx, int ny, int nthreads)
+{
+   fft_2d_plan *p;
+   int wr, wc, longest;
+
+   if (nx < 1 || ny < 1 || (long long)nx * ny > FFT_MAX_SIZE)
+      return NULL;
+   p = calloc(1, sizeof(*p));
+   if (!p)
+      return NULL;
+   p->nx = nx;
+   p->ny = ny;
+   p->rows = fft_plan_create(nx, FFT_SIMD);
+   p->cols = fft_plan_create(ny, FFT_SIMD);
+   if (!p->rows || !p->cols)
+   {
+      fft_2d_plan_destroy(p);
+      return NULL;
+   }
+   if (nthreads != 1 && ny > 1)
+   {
+      p->pool = fft_pool_create(nthreads);
+      if (!p->pool)
+      {
+         fft_2d_plan_destroy(p);
+         return NULL;
+      }
+   }
+   p->nslots = fft_pool_slots(p->pool);
+
+   // A conjugated row for the inverse, then the 1D plan's own scratch.
+   wr = fft_work_size(p->rows);
+   wc = fft_work_size(p->cols);
+   longest = nx > ny ? nx : ny;
+   p->slot_size = longest + (wr > wc ? wr : wc);
+   return p;
+}
+
+void fft_2d_plan_destroy(fft_2d_plan *plan)
+{
+   if (!plan)
+      return;
+   fft_pool_destroy(plan->pool);
+   fft_plan_destroy(plan->rows);
+   fft_plan_destroy(plan->cols);
+   free(plan);
+}
+
+int fft_2d_work_size(const fft_2d_plan *plan)
+{
+   return plan->nx * plan->ny + plan->nslots * plan->slot_size;
+}
+
+/* Rows (or tiles of rows) of the source each stage works through. */
+static int stage_units(const fft_2d_plan *plan, int stage)
+{
+   switch (stage)
+   {
+   case STAGE_ROWS:
+      return plan->ny;
+   case STAGE_COLS:
+      return plan->nx;
+   case STAGE_TRANSPOSE_OUT:
+      return (plan->ny + TILE - 1) / TILE;
+   default:
+      return (plan->nx + TILE - 1) / TILE;
+   }
+}
+
+static int stage_tasks(const fft_2d_plan *plan, int stage)
+{
+   int units = stage_units(plan, stage);
+   int tasks = plan->nslots * 4;
+
+   return tasks < units ? tasks : units;
+}
+
+/* dst = transpose of rows [r0, r1) of the rows x cols matrix src,
+   conjugated if conj is set. */
+static void transpose(const struct Complex *src, struct Complex *dst,
+                      int rows, int cols, int r0, int r1, int conj)
+{
+   double sign = conj ? -1.0 : 1.0;
+   int i, j, ii, jj, iend, jend;
+
+   for (ii = r0; ii < r1; ii += TILE)
+   {
+      iend = ii + TILE < r1 ? ii + TILE : r1;
+      for (jj = 0; jj < cols; jj += TILE)
+      {
+         jend = jj + TILE < cols ? jj + TILE : cols;
+         for (j = jj; j < jend; j++)
+            for (i = ii; i < iend; i++)
+            {
+               dst[(size_t)j * rows + i].a = src[(size_t)i * cols + j].a;
+               dst[(size_t)j * rows + i].b = sign * src[(size_t)i * cols + j].b;
+            }
+      }
+   }
+}
+
+static void fft_2d_task(void *arg, int task, int slot)
+{
+   const struct fft_2d_job *job = arg;
+   const fft_2d_plan *plan = job->plan;
+   int units = stage_units(plan, job->stage);
+   int tasks = stage_tasks(plan, job->stage);
+   struct Complex *row = job->work + (size_t)plan->nx * plan->ny +
+                         (size_t)slot * plan->slot_size;
+   struct Complex *scratch = row + (plan->nx > plan->ny ? plan->nx : plan->ny);
+   const struct Complex *src;
+   struct Complex *dst;
+   int u0, u1, r, k;
+
+   u0 = (int)((long long)units * task / tasks);
+   u1 = (int)((long long)units * (task + 1) / tasks);
+
+   switch (job->stage)
+   {
+   case STAGE_ROWS:
+      for (r = u0; r < u1; r++)
+      {
+         src = job->in + (size_t)r * plan->nx;
+         dst = job->out + (size_t)r * plan->nx;
+         if (job->inverse)
+         {
+            for (k = 0; k < plan->nx; k++)
+            {
+               row[k].a = src[k].a;
+               row[k].b = -src[k].b;
+            }
+            src = row;
+         }
+         fft_execute_work(plan->rows, src, dst, scratch);
+      }
+      break;
+
+   case STAGE_TRANSPOSE_OUT:
+      transpose(job->out, job->work, plan->ny, plan->nx, u0 * TILE,
+                u1 * TILE < plan->ny ? u1 * TILE : plan->ny, 0);
+      break;
+
+   case STAGE_COLS:
+      for (r = u0; r < u1; r++)
+      {
+         dst = job->work + (size_t)r * plan->ny;
+         fft_execute_work(plan->cols, dst, dst, scratch);
+      }
+      break;
+
+   case STAGE_TRANSPOSE_BACK:
+      transpose(job->work, job->out, plan->nx, plan->ny, u0 * TILE,
+                u1 * TILE < plan->nx ? u1 * TILE : plan->nx, job->inverse);
+      break;
+   }
+}
+
+void fft_2d_execute_work(const fft_2d_plan *plan, const struct Complex *in,
+                         struct Complex *out, int inverse,
+                         struct Complex *work)
+{
+   struct fft_2d_job job;
+
+   job.plan = plan;
+   job.inverse = inverse;
+   job.in = in;
+   job.out = out;
+   job.work = work;
+   for (job.stage = STAGE_ROWS; job.stage <= STAGE_TRANSPOSE_BACK; job.stage++)
+      fft_pool_run(plan->pool, fft_2d_task, &job, stage_tasks(plan, job.stage));
+}
+
+int fft_2d_execute(const fft_2d_plan *plan, const struct Complex *in,
+                   struct Complex *out, int inverse)
+{
+   struct Complex *work;
+
+   work = malloc((size_t)fft_2d_work_size(plan) * sizeof(*work));
+   if (!work)
+      return -1;
+   fft_2d_execute_work(plan, in, out, inverse, work);
+   free(work);
+   return 0;
+}
+
+int fft_2d_width(const fft_2d_plan *plan)
+{
+   return plan->nx;
+}
+
+int fft_2d_height(const fft_2d_plan *plan)
+{
+   return plan->ny;
+}
+
+
+void fft_2d_load_pixels(const fft_2d_plan *plan, const char *rgb,
+                        int width, int height, int channel,
+                        struct Complex *out)
+{
+   const unsigned char *px;
+   int x, y, w, h;
+
+   memset(out, 0, (size_t)plan->nx * plan->ny * sizeof(*out));
+   w = width < plan->nx ? width : plan->nx;
+   h = height < plan->ny ? height : plan->ny;
+   for (y = 0; y < h; y++)
+   {
+      px = (const unsigned char *)rgb + (size_t)y * width * 3;
+      for (x = 0; x < w; x++, px += 3)
+      {
+         if (channel == FFT_2D_GRAY)
+            out[(size_t)y * plan->nx + x].a =
+               0.299 * px[0] + 0.587 * px[1] + 0.114 * px[2];
+         else
+            out[(size_t)y * plan->nx + x].a = px[channel];
+      }
+   }
+}
+
+void fft_2d_load_plane(const fft_2d_plan *plan, const float *plane,
+                       int width, int height, struct Complex *out)
+{
+   int x, y, w, h;
+
+   memset(out, 0, (size_t)plan->nx * plan->ny * sizeof(*out));
+   w = width < plan->nx ? width : plan->nx;
+   h = height < plan->ny ? height : plan->ny;
+   for (y = 0; y < h; y++)
+      for (x = 0; x < w; x++)
+         out[(size_t)y * plan->nx + x].a = plane[(size_t)y * width + x];
+}
+
+void fft_2d_store_pixels(const fft_2d_plan *plan, const struct Complex *in,
+                         double scale, char *rgb, int width, int height,
+                         int channel)
+{
+   unsigned char *px;
+   double v;
+   int x, y, c, w, h;
+
+   w = width < plan->nx ? width : plan->nx;
+   h = height < plan->ny ? height : plan->ny;
+   for (y = 0; y < h; y++)
+   {
+      px = (unsigned char *)rgb + (size_t)y * width * 3;
+      for (x = 0; x < w; x++, px += 3)
+      {
+         v = in[(size_t)y * plan->nx + x].a * scale + 0.5;
+         v = v < 0.0 ? 0.0 : v > 255.0 ? 255.0 : v;
+         for (c = 0; c < 3; c++)
+            if (channel == FFT_2D_GRAY || channel == c)
+               px[c] = (unsigned char)v;
+      }
+   }
+}
@@ -0,0 +1,330 @@
+/*
+ * fft_batch.c
+ *
+ * Many same-length transforms per call, laid out the way cufftPlanMany()
+ * describes them: frame f, point k lives at in[f*idist + k*istride] and
+ * goes to out[f*odist + k*ostride].
+ *
+ * Two ways of running a batch:
+ *
+ *   Short frames (n <= BATCH_LANES_MAX_N) are transformed BATCH_LANES at a
+ *   time with one frame per vector lane: point k of the 8 frames is packed
+ *   into one vector, and every butterfly then works on all 8 frames at once
+ *   with the twiddle broadcast across lanes.  This vectorises even the
+ *   last passes, where a single short FFT has nothing left to vectorise.
+ *   Past 128 points the packed frames (128 bytes a point) spill out of L1
+ *   and the single-frame FFT_SIMD kernel is faster again.
+ *
+ *   Longer frames are run one at a time through an ordinary fft_plan with
+ *   the kernel from flags, gathering and scattering through scratch when
+ *   the stride is not 1.
+ *
+ * Either way, groups of frames are shared out over a thread pool.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fft_internal.h"
+
+#define BATCH_LANES        8
+#define BATCH_LANES_MAX_N  128
+
+typedef double lanes_t __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+
+struct fft_batch_plan
+{
+   int n, howmany;
+   int istride, idist, ostride, odist;
+   fft_plan *plan;            // single-frame plan; holds the twiddles
+   int *rev;                  // bit-reversal, lanes mode only
+   int lanes;                 // BATCH_LANES, or 1 for one frame at a time
+   int frames_per_task;
+   fft_pool *pool;
+   int nslots;
+   void **scratch;            // one buffer per pool slot
+};
+
+/* What the pool tasks need to see. */
+struct batch_job
+{
+   const fft_batch_plan *plan;
+   const struct Complex *in;
+   struct Complex *out;
+};
+
+
+/* (x.re + i x.im) * (wr + i wi) on a whole vector of lanes. */
+#define CMUL_RE(xr, xi, wr, wi) ((xr) * (wr) - (xi) * (wi))
+#define CMUL_IM(xr, xi, wr, wi) ((xr) * (wi) + (xi) * (wr))
+
+/* The radix4_dif() passes from fft.c over n points where every point is
+   BATCH_LANES frames wide.  Built for AVX-512, AVX2 and plain x86-64 with
+   the best one picked when the program loads. */
+__attribute__((target_clones("avx512f", "avx2", "default")))
+static void dif_lanes(lanes_t *re, lanes_t *im, int N, int M,
+                      const struct Complex *tw)
+{
+   lanes_t ar, ai, br, bi, cr, ci, dr, di, tr, ti;
+   lanes_t *r0, *r1, *r2, *r3, *i0, *i1, *i2, *i3;
+   int i, j, k, LE, q, step;
+
+   k = 0;
+   step = 1;
+   if (M % 2)
+   {
+      for (j = 0; j < N / 2; j++)
+      {
+         dr = re[j] - re[j + N / 2];
+         di = im[j] - im[j + N / 2];
+         re[j] = re[j] + re[j + N / 2];
+         im[j] = im[j] + im[j + N / 2];
+         re[j + N / 2] = CMUL_RE(dr, di, tw[j].a, tw[j].b);
+         im[j + N / 2] = CMUL_IM(dr, di, tw[j].a, tw[j].b);
+      }
+      k = 1;
+      step = 2;
+   }
+
+   for (; k < M; k += 2, step <<= 2)
+   {
+      LE = N >> k;
+      q = LE / 4;
+      for (i = 0; i < N; i = i + LE)
+      {
+         r0 = re + i;  r1 = r0 + q;  r2 = r1 + q;  r3 = r2 + q;
+         i0 = im + i;  i1 = i0 + q;  i2 = i1 + q;  i3 = i2 + q;
+         for (j = 0; j < q; j++)
+         {
+            ar = r0[j] + r2[j];      // A = x0 + x2
+            ai = i0[j] + i2[j];
+            br = r0[j] - r2[j];      // B = x0 - x2
+            bi = i0[j] - i2[j];
+            cr = r1[j] + r3[j];      // C = x1 + x3
+            ci = i1[j] + i3[j];
+            dr = i1[j] - i3[j];      // D = -i(x1 - x3)
+            di = r3[j] - r1[j];
+
+            r0[j] = ar + cr;
+            i0[j] = ai + ci;
+            tr = ar - cr;
+            ti = ai - ci;
+            r1[j] = CMUL_RE(tr, ti, tw[2 * j * step].a, tw[2 * j * step].b);
+            i1[j] = CMUL_IM(tr, ti, tw[2 * j * step].a, tw[2 * j * step].b);
+            tr = br + dr;
+            ti = bi + di;
+            r2[j] = CMUL_RE(tr, ti, tw[j * step].a, tw[j * step].b);
+            i2[j] = CMUL_IM(tr, ti, tw[j * step].a, tw[j * step].b);
+            tr = br - dr;
+            ti = bi - di;
+            r3[j] = CMUL_RE(tr, ti, tw[3 * j * step].a, tw[3 * j * step].b);
+            i3[j] = CMUL_IM(tr, ti, tw[3 * j * step].a, tw[3 * j * step].b);
+         }
+      }
+   }
+}
+
+static void run_lanes(const struct batch_job *job, int first, int count,
+                      int slot)
+{
+   const fft_batch_plan *p = job->plan;
+   int N = p->n;
+   lanes_t *re = p->scratch[slot];
+   lanes_t *im = re + N;
+   // Plain double views of the same scratch for packing and unpacking;
+   // writing single lanes through the vector type is much slower.
+   double *rd = (double *)re;
+   double *id = (double *)im;
+   const struct Complex *src;
+   struct Complex *dst;
+   int f, k, v, nv;
+
+   for (f = first; f < first + count; f += BATCH_LANES)
+   {
+      nv = first + count - f;
+      if (nv > BATCH_LANES)
+         nv = BATCH_LANES;
+      // One frame at a time, so each frame is read in order.  Unused
+      // lanes in the last group are zeroed rather than left as garbage.
+      for (v = 0; v < BATCH_LANES; v++)
+      {
+         if (v >= nv)
+         {
+            for (k = 0; k < N; k++)
+               rd[k * BATCH_LANES + v] = id[k * BATCH_LANES + v] = 0.0;
+            continue;
+         }
+         src = job->in + (size_t)(f + v) * p->idist;
+         for (k = 0; k < N; k++)
+         {
+            rd[k * BATCH_LANES + v] = src[(size_t)k * p->istride].a;
+            id[k * BATCH_LANES + v] = src[(size_t)k * p->istride].b;
+         }
+      }
+
+      dif_lanes(re, im, N, p->plan->m, p->plan->twiddle);
+
+      for (v = 0; v < nv; v++)
+      {
+         dst = job->out + (size_t)(f + v) * p->odist;
+         for (k = 0; k < N; k++)
+         {
+            dst[(size_t)p->rev[k] * p->ostride].a = rd[k * BATCH_LANES + v];
+            dst[(size_t)p->rev[k] * p->ostride].b = id[k * BATCH_LANES + v];
+         }
+      }
+   }
+}
+
+static void run_frames(const struct batch_job *job, int first, int count,
+                       int slot)
+{
+   const fft_batch_plan *p = job->plan;
+   int N = p->n;
+   struct Complex *buf = p->scratch[slot];
+   struct Complex *work = buf + N;
+   const struct Complex *src;
+   struct Complex *dst;
+   int f, k;
+
+   for (f = first; f < first + count; f++)
+   {
+      src = job->in + (size_t)f * p->idist;
+      dst = job->out + (size_t)f * p->odist;
+      if (p->istride != 1)
+      {
+         for (k = 0; k < N; k++)
+            buf[k] = src[(size_t)k * p->istride];
+         src = buf;
+      }
+      if (p->ostride != 1)
+      {
+         fft_execute_work(p->plan, src, buf, work);
+         for (k = 0; k < N; k++)
+            dst[(size_t)k * p->ostride] = buf[k];
+      }
+      else
+         fft_execute_work(p->plan, src, dst, work);
+   }
+}
+
+static void batch_task(void *arg, int task, int slot)
+{
+   const struct batch_job *job = arg;
+   const fft_batch_plan *p = job->plan;
+   int first = task * p->frames_per_task;
+   int count = p->howmany - first;
+
+   if (count > p->frames_per_task)
+      count = p->frames_per_task;
+   if (p->lanes > 1)
+      run_lanes(job, first, count, slot);
+   else
+      run_frames(job, first, count, slot);
+}
+
+fft_batch_plan *fft_batch_plan_create(int n, int howmany,
+                                      int istride, int idist,
+                                      int ostride, int odist,
+                                      int flags, int nthreads)
+{
+   fft_batch_plan *p;
+   size_t bytes;
+   int i, tasks;
+
+   if (howmany < 1 || istride < 1 || ostride < 1 || idist < 0 || odist < 0)
+      return NULL;
+   p = calloc(1, sizeof(*p));
+   if (!p)
+      return NULL;
+   p->n = n;
+   p->howmany = howmany;
+   p->istride = istride;
+   p->idist = idist;
+   p->ostride = ostride;
+   p->odist = odist;
+   p->lanes = (n >= 2 && n <= BATCH_LANES_MAX_N && (n & (n - 1)) == 0 &&
+               howmany > 1) ?
+              BATCH_LANES : 1;
+   // Lanes mode only takes the twiddles from the plan, and only the
+   // in-place kernels have that table, so it gets one of those whatever
+   // was asked for.
+   if (p->lanes > 1)
+      p->plan = fft_plan_create(n, FFT_RADIX4 | (flags & FFT_INVERSE));
+   else
+      p->plan = fft_plan_create(n, flags);
+   if (!p->plan)
+   {
+      fft_batch_plan_destroy(p);
+      return NULL;
+   }
+   if (p->lanes > 1)
+   {
+      p->rev = malloc(n * sizeof(*p->rev));
+      if (!p->rev)
+      {
+         fft_batch_plan_destroy(p);
+         return NULL;
+      }
+      fft_bit_reverse_table(p->rev, n);
+      if (flags & FFT_INVERSE)
+         fft_inverse_table(p->rev, n);
+   }
+
+   if (nthreads != 1 && howmany > p->lanes)
+      p->pool = fft_pool_create(nthreads);
+   p->nslots = fft_pool_slots(p->pool);
+
+   // A few tasks per thread so that uneven threads even out, in whole
+   // groups of lanes.
+   tasks = p->nslots * 4;
+   p->frames_per_task = (howmany + tasks - 1) / tasks;
+   p->frames_per_task = (p->frames_per_task + p->lanes - 1) / p->lanes * p->lanes;
+
+   if (p->lanes > 1)
+      bytes = 2 * (size_t)n * sizeof(lanes_t);
+   else
+      bytes = ((size_t)n + fft_work_size(p->plan)) * sizeof(struct Complex);
+   p->scratch = calloc(p->nslots, sizeof(*p->scratch));
+   if (!p->scratch)
+   {
+      fft_batch_plan_destroy(p);
+      return NULL;
+   }
+   for (i = 0; i < p->nslots; i++)
+      if (posix_memalign(&p->scratch[i], sizeof(lanes_t), bytes) != 0)
+      {
+         p->scratch[i] = NULL;
+         fft_batch_plan_destroy(p);
+         return NULL;
+      }
+   return p;
+}
+
+void fft_batch_plan_destroy(fft_batch_plan *p)
+{
+   int i;
+
+   if (!p)
+      return;
+   fft_pool_destroy(p->pool);
+   if (p->scratch)
+      for (i = 0; i < p->nslots; i++)
+         free(p->scratch[i]);
+   free(p->scratch);
+   free(p->rev);
+   fft_plan_destroy(p->plan);
+   free(p);
+}
+
+void fft_batch_execute(fft_batch_plan *plan, const struct Complex *in,
+                       struct Complex *out)
+{
+   struct batch_job job;
+
+   job.plan = plan;
+   job.in = in;
+   job.out = out;
+   fft_pool_run(plan->pool, batch_task, &job,
+                (plan->howmany + plan->frames_per_task - 1) /
+                plan->frames_per_task);
+}
@@ -0,0 +1,1362 @@
+/*
+ * fft_bench.c
+ *
+ * Times the FFT kernels in fft.c against each other over a range of sizes.
+ *
+ *   ./fft_bench [max_log2n]
+ *   ./fft_bench -c rohan_data.txt
+ *   ./fft_bench -b n howmany [threads]
+ *   ./fft_bench -t log2n [max_threads]
+ *   ./fft_bench -u n howmany
+ *   ./fft_bench -f taps [block]
+ *   ./fft_bench -n n [n ...]
+ *   ./fft_bench -q [max_log2n]
+ *   ./fft_bench -w max_log2n [wisdom_file]
+ *   ./fft_bench -g n [max_bins]
+ *   ./fft_bench -d n [samples]
+ *   ./fft_bench -p [capture.txt]
+ *   ./fft_bench -m n channels [threads]
+ *   ./fft_bench -W n
+ *
+ * For each size every kernel is run enough times to process about 2^24
+ * points, best of three runs.  The time per transform is printed along with
+ * the usual 5*N*log2(N) "MFLOPS" figure so different sizes can be compared.
+ *
+ * With -c the samples in the given file are transformed by every kernel and
+ * the largest difference from the radix-2 result is printed, then the same
+ * for batch plans of each kernel on a test signal at n = 64 and 128, which
+ * run in vector lanes, followed by the max and rms error of the float
+ * engine against the double one.
+ *
+ * With -b, howmany contiguous frames of n points are transformed with one
+ * FFT_SIMD plan in a loop and then with a batch plan, and the time per
+ * frame of each is printed.
+ *
+ * With -t, one 2^log2n point transform is timed with the single-threaded
+ * FFT_SIMD kernel and then with FFT_FOUR_STEP on 1, 2, ... max_threads
+ * threads (default one per CPU), to show how the four-step kernel scales.
+ *
+ * With -u, howmany frames of n points go through cufftExecC2C() and
+ * cufftExecR2C() on the CPU backend, and the throughput is printed in the
+ * units the cuFFT benchmarks use, so the numbers line up with a GPU run of
+ * the same calls.
+ *
+ * With -f, 2^20 random samples are run through a taps-long FIR filter by
+ * direct convolution and by fft_conv with overlap-add and overlap-save
+ * (block 0 lets fft_conv choose), printing the time per sample of each and
+ * the largest difference from the direct result.
+ *
+ * With -n, each length given is timed with the kernel fft_plan_create()
+ * picks for it (mixed radix or Bluestein when it is not a power of two)
+ * next to FFT_SIMD at the nearest power of two above it.
+ *
+ * With -q, a 12-bit ADC-like signal (a tone plus noise around mid-scale,
+ * as integer counts) goes through the Q15 and Q31 fixed-point transforms
+ * for n = 16 up to 2^max_log2n (default 2^16), and the SNR of each against
+ * the double engine is printed with its time per transform.
+ *
+ * With -w, an FFT_MEASURE plan is made for n = 16 up to 2^max_log2n with
+ * the wisdom in wisdom_file loaded first, and the kernel it settled on is
+ * printed with the time the plan took to make, then the wisdom is saved
+ * back.  Run it twice to see the second run plan from the file.
+ *
+ * With -g, 1, 2, ... max_bins (default 16) bins of an n-point real frame
+ * are computed by the Goertzel bank and by the real FFT, and the time of
+ * each is printed with the method FFT_GOERTZEL_AUTO would pick and the
+ * largest difference between the two.
+ *
+ * With -d, samples (default 2^20) samples of an ADC-like signal slide
+ * through an n-point sliding DFT tracking every bin and then just one,
+ * with the default re-anchoring and with none, and the time per sample is
+ * printed with the largest error of the final bins against a real FFT of
+ * the last n samples, relative to the peak bin.
+ *
+ * With -p, a text capture (by default a 100 MB one of random 12-bit
+ * counts, written to fft_parse.txt and removed afterwards) is read with the
+ * fscanf() loop rohan_fft.c used to have and with adc_text_read(), and the
+ * time and MB/s of each are printed with the largest difference between
+ * the two.
+ *
+ * With -m, blocks of n samples on each of channels interleaved channels
+ * are transformed channel by channel (gathering each one out of the block
+ * and running the real FFT on it) and then with a multi-channel plan on
+ * one thread and on threads threads (default one per CPU), and the time
+ * per block of each is printed with the largest difference in the bins.
+ *
+ * With -W, a tone half way between two bins of an n-point frame is run
+ * through every window, printing its coherent gain and ENBW, the tone's
+ * amplitude after the gain is divided out (its loss to scalloping), the
+ * most that leaks 16 or more bins away, and the time per frame with the
+ * window applied in a pass of its own and fused into the r2c packing.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fft.h"
+#include "cufft.h"
+#include "adc_text.h"
+
+struct Kernel
+{
+   const char *name;
+   int flags;
+   int single;   // run through fftf_plan instead of fft_plan
+};
+
+static const struct Kernel kernels[] =
+{
+   { "radix2",   FFT_RADIX2 },
+   { "stockham", FFT_STOCKHAM },
+   { "radix4",   FFT_RADIX4 },
+   { "split",    FFT_SPLIT_RADIX },
+   { "sse2",     FFT_SIMD | FFT_ISA_SSE2 },
+   { "avx2",     FFT_SIMD | FFT_ISA_AVX2 },
+   { "avx512",   FFT_SIMD | FFT_ISA_AVX512 },
+   { "codelet",  FFT_CODELET },
+   { "4step",    FFT_FOUR_STEP },
+   { "float32",  0, 1 },
+};
+#define N_KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Best-of-three time for one float transform, in seconds, or -1 on
+   failure. */
+static double time_float(int n, int flags, const struct Complex *in)
+{
+   fftf_plan *plan;
+   struct ComplexF *x, *y, *work;
+   double best = -1.0, t;
+   int reps, r, trial, i;
+
+   plan = fftf_plan_create(n, flags);
+   x = malloc(n * sizeof(*x));
+   y = malloc(n * sizeof(*y));
+   work = malloc(n * sizeof(*work));
+   if (plan && x && y && work)
+   {
+      for (i = 0; i < n; i++)
+      {
+         x[i].a = in[i].a;
+         x[i].b = in[i].b;
+      }
+      reps = (1 << 24) / n;
+      if (reps < 3)
+         reps = 3;
+      fftf_execute_work(plan, x, y, work);
+      for (trial = 0; trial < 3; trial++)
+      {
+         t = now();
+         for (r = 0; r < reps; r++)
+            fftf_execute_work(plan, x, y, work);
+         t = (now() - t) / reps;
+         if (best < 0 || t < best)
+            best = t;
+      }
+   }
+   free(x);
+   free(y);
+   free(work);
+   fftf_plan_destroy(plan);
+   return best;
+}
+
+/* Best-of-three time for one transform, in seconds, or -1 on failure. */
+static double time_kernel(int n, int flags, int nthreads,
+                          struct Complex *in, struct Complex *out)
+{
+   fft_plan *plan;
+   struct Complex *work = NULL;
+   double best = -1.0, t;
+   int reps, r, trial;
+
+   plan = fft_plan_create_threaded(n, flags, nthreads);
+   if (!plan)
+      return -1.0;
+   if (fft_work_size(plan) > 0)
+   {
+      work = malloc(fft_work_size(plan) * sizeof(*work));
+      if (!work)
+      {
+         fft_plan_destroy(plan);
+         return -1.0;
+      }
+   }
+
+   reps = (1 << 24) / n;
+   if (reps < 3)
+      reps = 3;
+   fft_execute_work(plan, in, out, work);   // warm up caches and pages
+   for (trial = 0; trial < 3; trial++)
+   {
+      t = now();
+      for (r = 0; r < reps; r++)
+         fft_execute_work(plan, in, out, work);
+      t = (now() - t) / reps;
+      if (best < 0 || t < best)
+         best = t;
+   }
+   free(work);
+   fft_plan_destroy(plan);
+   return best;
+}
+
+/* Kernels the batch check asks for besides those in kernels[]. */
+static const struct Kernel batch_extra[] =
+{
+   { "measure",  FFT_MEASURE },
+   { "mixed",    FFT_MIXED_RADIX },
+   { "bluestein", FFT_BLUESTEIN },
+};
+#define N_BATCH_EXTRA (int)(sizeof(batch_extra) / sizeof(batch_extra[0]))
+
+/* Runs BATCH_FRAMES frames of a test signal through a batch plan of each
+   kernel at the short lengths that batch in vector lanes, and prints the
+   largest difference from a radix-2 plan frame by frame. */
+#define BATCH_FRAMES 3
+static void compare_batches(void)
+{
+   const struct Kernel *kern;
+   struct Complex x[BATCH_FRAMES * 128];
+   struct Complex ref[BATCH_FRAMES * 128], out[BATCH_FRAMES * 128];
+   fft_batch_plan *batch;
+   fft_plan *plan;
+   double diff;
+   int n, k, i;
+
+   for (i = 0; i < BATCH_FRAMES * 128; i++)
+   {
+      x[i].a = sin(0.37 * i);
+      x[i].b = cos(1.1 * i) * 0.5;
+   }
+   for (n = 64; n <= 128; n *= 2)
+   {
+      plan = fft_plan_create(n, FFT_RADIX2);
+      if (!plan)
+         return;
+      for (i = 0; i < BATCH_FRAMES; i++)
+         fft_execute(plan, x + i * n, ref + i * n);
+      fft_plan_destroy(plan);
+      for (k = 0; k < N_KERNELS + N_BATCH_EXTRA; k++)
+      {
+         kern = k < N_KERNELS ? &kernels[k] : &batch_extra[k - N_KERNELS];
+         if (kern->single)
+            continue;
+         batch = fft_batch_plan_create(n, BATCH_FRAMES, 1, n, 1, n,
+                                       kern->flags, 1);
+         if (!batch)
+         {
+            printf("batch %-4d %-10s failed\n", n, kern->name);
+            continue;
+         }
+         fft_batch_execute(batch, x, out);
+         fft_batch_plan_destroy(batch);
+         diff = 0.0;
+         for (i = 0; i < BATCH_FRAMES * n; i++)
+            if (hypot(out[i].a - ref[i].a, out[i].b - ref[i].b) > diff)
+               diff = hypot(out[i].a - ref[i].a, out[i].b - ref[i].b);
+         printf("batch %-4d %-10s max |X - X_radix2| = %g\n", n, kern->name,
+                diff);
+      }
+   }
+}
+
+/* Error of the float engine on x against the double result ref. */
+static void compare_float(const struct Complex *x, const struct Complex *ref,
+                          int n)
+{
+   fftf_plan *plan = fftf_plan_create(n, 0);
+   struct ComplexF *xf = malloc(n * sizeof(*xf));
+   double d, diff = 0.0, peak = 0.0, err2 = 0.0, sig2 = 0.0;
+   int i;
+
+   if (!plan || !xf)
+   {
+      printf("float32    failed\n");
+      fftf_plan_destroy(plan);
+      free(xf);
+      return;
+   }
+   for (i = 0; i < n; i++)
+   {
+      xf[i].a = x[i].a;
+      xf[i].b = x[i].b;
+   }
+   fftf_execute(plan, xf, xf);
+   for (i = 0; i < n; i++)
+   {
+      d = hypot(xf[i].a - ref[i].a, xf[i].b - ref[i].b);
+      if (d > diff)
+         diff = d;
+      if (hypot(ref[i].a, ref[i].b) > peak)
+         peak = hypot(ref[i].a, ref[i].b);
+      err2 += d * d;
+      sig2 += ref[i].a * ref[i].a + ref[i].b * ref[i].b;
+   }
+   printf("float32    max |X - X_double| = %g (%g of peak)\n",
+          diff, peak > 0 ? diff / peak : 0.0);
+   printf("float32    rms |X - X_double| = %g (%g of rms)\n",
+          sqrt(err2 / n), sig2 > 0 ? sqrt(err2 / sig2) : 0.0);
+   fftf_plan_destroy(plan);
+   free(xf);
+}
+
+/* Runs every kernel on the samples in filename (scaled to volts the same
+   way rohan_fft.c does) and prints how far each is from radix-2. */
+static int compare_kernels(const char *filename)
+{
+   FILE *ip;
+   struct Complex *x, *ref, *out;
+   float fm;
+   int n = 0, size = 1024, k, i;
+   double diff, peak;
+
+   ip = fopen(filename, "r");
+   if (!ip)
+   {
+      printf("Not Opened\n");
+      return 1;
+   }
+   x = malloc(size * sizeof(*x));
+   while (x && fscanf(ip, "%f", &fm) == 1)
+   {
+      if (n == size)
+      {
+         size *= 2;
+         x = realloc(x, size * sizeof(*x));
+         if (!x)
+            break;
+      }
+      x[n].a = fm * 3.3 / 4095;
+      x[n].b = 0.0;
+      n++;
+   }
+   fclose(ip);
+   if (!x || size > FFT_MAX_SIZE)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = n; i < size; i++)
+      x[i].a = x[i].b = 0.0;
+
+   ref = malloc(size * sizeof(*ref));
+   out = malloc(size * sizeof(*out));
+   if (!ref || !out)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   printf("%d samples, zero padded to %d\n", n, size);
+
+   for (k = 0; k < N_KERNELS; k++)
+   {
+      fft_plan *plan;
+
+      if (kernels[k].single)
+         continue;
+      plan = fft_plan_create(size, kernels[k].flags);
+      if (!plan || fft_execute(plan, x, k == 0 ? ref : out) < 0)
+      {
+         printf("%-10s failed\n", kernels[k].name);
+         fft_plan_destroy(plan);
+         continue;
+      }
+      fft_plan_destroy(plan);
+      if (k == 0)
+         continue;
+      diff = 0.0;
+      peak = 0.0;
+      for (i = 0; i < size; i++)
+      {
+         if (hypot(out[i].a - ref[i].a, out[i].b - ref[i].b) > diff)
+            diff = hypot(out[i].a - ref[i].a, out[i].b - ref[i].b);
+         if (hypot(ref[i].a, ref[i].b) > peak)
+            peak = hypot(ref[i].a, ref[i].b);
+      }
+      printf("%-10s max |X - X_radix2| = %g (%g of peak)\n",
+             kernels[k].name, diff, peak > 0 ? diff / peak : 0.0);
+   }
+   compare_batches();
+   compare_float(x, ref, size);
+   free(x);
+   free(ref);
+   free(out);
+   return 0;
+}
+
+/* Per-frame time of a plain loop over frames against fft_batch_execute(). */
+static int bench_batch(int n, int howmany, int nthreads)
+{
+   struct Complex *in, *out, *work;
+   fft_plan *plan;
+   fft_batch_plan *batch;
+   double t, tloop = -1.0, tbatch = -1.0;
+   size_t i, total = (size_t)n * howmany;
+   int f, trial;
+
+   in = malloc(total * sizeof(*in));
+   out = malloc(total * sizeof(*out));
+   work = malloc(n * sizeof(*work));
+   plan = fft_plan_create(n, FFT_SIMD);
+   batch = fft_batch_plan_create(n, howmany, 1, n, 1, n, FFT_SIMD, nthreads);
+   if (!in || !out || !work || !plan || !batch)
+   {
+      printf("Bad size or out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < total; i++)
+   {
+      in[i].a = (double)rand() / RAND_MAX - 0.5;
+      in[i].b = (double)rand() / RAND_MAX - 0.5;
+   }
+
+   for (trial = 0; trial < 4; trial++)   // first round warms up
+   {
+      t = now();
+      for (f = 0; f < howmany; f++)
+         fft_execute_work(plan, in + (size_t)f * n, out + (size_t)f * n, work);
+      t = now() - t;
+      if (trial > 0 && (tloop < 0 || t < tloop))
+         tloop = t;
+
+      t = now();
+      fft_batch_execute(batch, in, out);
+      t = now() - t;
+      if (trial > 0 && (tbatch < 0 || t < tbatch))
+         tbatch = t;
+   }
+   printf("%d frames of %d points\n", howmany, n);
+   printf("  one at a time  %10.3fus per frame\n", tloop / howmany * 1e6);
+   printf("  batched        %10.3fus per frame  (%.2fx)\n",
+          tbatch / howmany * 1e6, tloop / tbatch);
+
+   fft_batch_plan_destroy(batch);
+   fft_plan_destroy(plan);
+   free(in);
+   free(out);
+   free(work);
+   return 0;
+}
+
+/* Interleaved multi-channel transforms, see -m above. */
+static int bench_multi(int n, int channels, int nthreads)
+{
+   const int bins = n / 2 + 1, blocks = 64;
+   fft_real_plan *real;
+   fft_multi_plan *one, *many;
+   struct Complex *ref, *got, *work;
+   double *in, *x, t, tloop = -1.0, tone = -1.0, tmany = -1.0, err = 0.0;
+   size_t i;
+   int b, c, k, trial;
+
+   if (n < 2 || n % 2 != 0 || channels < 1)
+   {
+      printf("n must be even and channels at least 1\n");
+      return 1;
+   }
+   in = malloc((size_t)blocks * n * channels * sizeof(*in));
+   x = malloc(n * sizeof(*x));
+   ref = malloc((size_t)bins * channels * sizeof(*ref));
+   got = malloc((size_t)bins * channels * sizeof(*got));
+   real = fft_real_plan_create(n, FFT_SIMD);
+   one = fft_multi_plan_create(n, channels, FFT_SIMD, 1);
+   many = fft_multi_plan_create(n, channels, FFT_SIMD, nthreads);
+   work = real ? malloc(fft_real_work_size(real) * sizeof(*work)) : NULL;
+   if (!in || !x || !ref || !got || !real || !one || !many || !work)
+   {
+      printf("Bad size or out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < (size_t)blocks * n * channels; i++)
+      in[i] = 2048.0 + 1500.0 * sin(0.01 * i) + rand() % 100;
+
+   for (trial = 0; trial < 4; trial++)   // first round warms up
+   {
+      t = now();
+      for (b = 0; b < blocks; b++)
+         for (c = 0; c < channels; c++)
+         {
+            for (k = 0; k < n; k++)
+               x[k] = in[((size_t)b * n + k) * channels + c];
+            fft_execute_r2c_work(real, x, ref + (size_t)c * bins, work);
+         }
+      t = now() - t;
+      if (trial > 0 && (tloop < 0 || t < tloop))
+         tloop = t;
+
+      t = now();
+      for (b = 0; b < blocks; b++)
+         fft_multi_execute(one, in + (size_t)b * n * channels, got, NULL);
+      t = now() - t;
+      if (trial > 0 && (tone < 0 || t < tone))
+         tone = t;
+
+      t = now();
+      for (b = 0; b < blocks; b++)
+         fft_multi_execute(many, in + (size_t)b * n * channels, got, NULL);
+      t = now() - t;
+      if (trial > 0 && (tmany < 0 || t < tmany))
+         tmany = t;
+   }
+   // ref and got both hold the last block now.
+   for (i = 0; i < (size_t)bins * channels; i++)
+      if (hypot(got[i].a - ref[i].a, got[i].b - ref[i].b) > err)
+         err = hypot(got[i].a - ref[i].a, got[i].b - ref[i].b);
+
+   printf("%d channels of %d points, %ld CPUs\n", channels, n,
+          sysconf(_SC_NPROCESSORS_ONLN));
+   printf("  channel by channel %10.3fus per block\n", tloop / blocks * 1e6);
+   printf("  multi, 1 thread    %10.3fus per block  (%.2fx)\n",
+          tone / blocks * 1e6, tloop / tone);
+   printf("  multi, threaded    %10.3fus per block  (%.2fx)\n",
+          tmany / blocks * 1e6, tloop / tmany);
+   printf("  largest difference %g\n", err);
+
+   fft_multi_plan_destroy(one);
+   fft_multi_plan_destroy(many);
+   fft_real_plan_destroy(real);
+   free(in);
+   free(x);
+   free(ref);
+   free(got);
+   free(work);
+   return 0;
+}
+
+/* Time of FFT_FOUR_STEP on 1..max_threads threads against FFT_SIMD. */
+static int bench_threads(int log2n, int max_threads)
+{
+   struct Complex *in, *out;
+   size_t i, n = (size_t)1 << log2n;
+   double t, tsimd;
+   int k;
+
+   if (log2n < 1 || log2n > FFT_MAX_LOG2N)
+   {
+      printf("log2n must be between 1 and %d\n", FFT_MAX_LOG2N);
+      return 1;
+   }
+   if (max_threads <= 0)
+      max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+   in = malloc(n * sizeof(*in));
+   out = malloc(n * sizeof(*out));
+   if (!in || !out)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < n; i++)
+   {
+      in[i].a = (double)rand() / RAND_MAX - 0.5;
+      in[i].b = (double)rand() / RAND_MAX - 0.5;
+   }
+
+   tsimd = time_kernel(n, FFT_SIMD, 1, in, out);
+   printf("N = %zu\n", n);
+   printf("  simd            %10.3fms\n", tsimd * 1e3);
+   for (k = 1; k <= max_threads; k++)
+   {
+      t = time_kernel(n, FFT_FOUR_STEP, k, in, out);
+      if (t < 0)
+      {
+         printf("  4step %2d threads  failed\n", k);
+         continue;
+      }
+      printf("  4step %2d threads %10.3fms  (%.2fx)\n", k, t * 1e3,
+             tsimd / t);
+   }
+   free(in);
+   free(out);
+   return 0;
+}
+
+/* Best-of-three time of one cufftExec call on plan, or -1 on failure. */
+static double time_cufft(cufftHandle plan, cufftType type, void *in,
+                         void *out)
+{
+   double t, best = -1.0;
+   int trial;
+   cufftResult r;
+
+   for (trial = 0; trial < 4; trial++)   // first round warms up
+   {
+      t = now();
+      if (type == CUFFT_C2C)
+         r = cufftExecC2C(plan, in, out, CUFFT_FORWARD);
+      else
+         r = cufftExecR2C(plan, in, out);
+      t = now() - t;
+      if (r != CUFFT_SUCCESS)
+         return -1.0;
+      if (trial > 0 && (best < 0 || t < best))
+         best = t;
+   }
+   return best;
+}
+
+/* Throughput of the cuFFT entry points, C2C and R2C. */
+static int bench_cufft(int n, int howmany)
+{
+   cufftHandle plan;
+   cufftComplex *c, *out;
+   cufftReal *r;
+   double t, flops;
+   size_t i, total = (size_t)n * howmany;
+   int k;
+
+   c = malloc(total * sizeof(*c));
+   out = malloc(total * sizeof(*out));
+   r = malloc(total * sizeof(*r));
+   if (!c || !out || !r || n < 2 || howmany < 1)
+   {
+      printf("Bad size or out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < total; i++)
+   {
+      c[i].x = r[i] = (float)rand() / RAND_MAX - 0.5f;
+      c[i].y = (float)rand() / RAND_MAX - 0.5f;
+   }
+   for (k = 0; (1 << k) < n; k++)
+      ;
+   flops = 5.0 * n * k * howmany;   // the usual figure for a complex FFT
+
+   printf("%d frames of %d points\n", howmany, n);
+   for (i = 0; i < 2; i++)
+   {
+      cufftType type = i == 0 ? CUFFT_C2C : CUFFT_R2C;
+
+      if (cufftPlan1d(&plan, n, type, howmany) != CUFFT_SUCCESS)
+      {
+         printf("  plan failed\n");
+         continue;
+      }
+      t = time_cufft(plan, type, i == 0 ? (void *)c : (void *)r, out);
+      cufftDestroy(plan);
+      if (t < 0)
+      {
+         printf("  exec failed\n");
+         continue;
+      }
+      // Real transforms are quoted at half the complex flop count.
+      printf("  %s %10.3fms  %8.2f GFLOPS  %8.2f Msamples/s\n",
+             i == 0 ? "C2C" : "R2C", t * 1e3,
+             (i == 0 ? flops : flops / 2) / t * 1e-9, total / t * 1e-6);
+   }
+   free(c);
+   free(out);
+   free(r);
+   return 0;
+}
+
+/* Direct FIR filter against fft_conv, see -f above. */
+static int bench_conv(int taps, int block)
+{
+   const int len = 1 << 20;
+   double *h, *x, *ref, *y;
+   double t, tdirect, diff;
+   fft_conv *conv;
+   int i, j, method;
+
+   h = malloc(taps * sizeof(*h));
+   x = malloc(len * sizeof(*x));
+   ref = malloc(len * sizeof(*ref));
+   y = malloc(len * sizeof(*y));
+   if (taps < 1 || block < 0 || !h || !x || !ref || !y)
+   {
+      printf("Bad size or out of memory\n");
+      return 1;
+   }
+   for (j = 0; j < taps; j++)
+      h[j] = (double)rand() / RAND_MAX - 0.5;
+   for (i = 0; i < len; i++)
+      x[i] = (double)rand() / RAND_MAX - 0.5;
+
+   t = now();
+   for (i = 0; i < len; i++)
+   {
+      double acc = 0.0;
+      for (j = 0; j < taps && j <= i; j++)
+         acc += h[j] * x[i - j];
+      ref[i] = acc;
+   }
+   tdirect = (now() - t) / len;
+   printf("%d taps, %d samples\n", taps, len);
+   printf("  direct              %10.3fns per sample\n", tdirect * 1e9);
+
+   for (method = FFT_CONV_OLA; method <= FFT_CONV_OLS; method++)
+   {
+      conv = fft_conv_create(h, taps, block, method);
+      if (!conv)
+      {
+         printf("  %s failed\n", method == FFT_CONV_OLA ? "ola" : "ols");
+         continue;
+      }
+      // Whole blocks only; the tail that does not fill one is skipped.
+      t = now();
+      for (i = 0; i + fft_conv_block_size(conv) <= len;
+           i += fft_conv_block_size(conv))
+         fft_conv_process(conv, x + i, y + i);
+      t = now() - t;
+      diff = 0.0;
+      for (j = 0; j < i; j++)
+         if (fabs(y[j] - ref[j]) > diff)
+            diff = fabs(y[j] - ref[j]);
+      printf("  %s block %6d %10.3fns per sample  (%.1fx)  max diff %g\n",
+             method == FFT_CONV_OLA ? "ola" : "ols",
+             fft_conv_block_size(conv), t / i * 1e9, tdirect / (t / i),
+             diff);
+      fft_conv_destroy(conv);
+   }
+   free(h);
+   free(x);
+   free(ref);
+   free(y);
+   return 0;
+}
+
+/* Any-length plans against the next power of two, see -n above. */
+static int bench_lengths(int count, char **lengths)
+{
+   struct Complex *in, *out;
+   double t, tpow2;
+   int i, j, n, p;
+
+   printf("%10s %12s %10s %12s %8s\n", "N", "time", "2^k >= N", "time", "ratio");
+   for (i = 0; i < count; i++)
+   {
+      n = atoi(lengths[i]);
+      if (n < 1 || n > FFT_MAX_SIZE / 2)
+      {
+         printf("%10s bad length\n", lengths[i]);
+         continue;
+      }
+      for (p = 1; p < n; p *= 2)
+         ;
+      in = malloc(p * sizeof(*in));
+      out = malloc(p * sizeof(*out));
+      if (!in || !out)
+      {
+         printf("Out of memory\n");
+         return 1;
+      }
+      for (j = 0; j < p; j++)
+      {
+         in[j].a = (double)rand() / RAND_MAX - 0.5;
+         in[j].b = (double)rand() / RAND_MAX - 0.5;
+      }
+      t = time_kernel(n, FFT_SIMD, 1, in, out);
+      tpow2 = time_kernel(p, FFT_SIMD, 1, in, out);
+      printf("%10d %10.2fus %10d %10.2fus %8.2f\n", n, t * 1e6, p,
+             tpow2 * 1e6, t / tpow2);
+      free(in);
+      free(out);
+   }
+   return 0;
+}
+
+/* 10 log10 of signal power over error power, got against ref. */
+static double snr_db(const struct Complex *ref, const struct Complex *got,
+                     int n)
+{
+   double sig2 = 0.0, err2 = 0.0, da, db;
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      da = got[i].a - ref[i].a;
+      db = got[i].b - ref[i].b;
+      sig2 += ref[i].a * ref[i].a + ref[i].b * ref[i].b;
+      err2 += da * da + db * db;
+   }
+   return err2 > 0 ? 10.0 * log10(sig2 / err2) : INFINITY;
+}
+
+/* Fixed point against double on ADC counts, see -q above. */
+static int bench_fixed(int max_log2n)
+{
+   struct ComplexQ15 *x15, *y15;
+   struct ComplexQ31 *x31, *y31;
+   struct Complex *in, *ref, *got;
+   fft_fixed_plan *plan;
+   fft_plan *dplan;
+   double t, t15, t31, snr15, snr31;
+   int m, n, i, r, reps, e15 = 0, e31 = 0, size;
+
+   if (max_log2n < 4 || max_log2n > FFT_MAX_LOG2N)
+   {
+      printf("max_log2n must be between 4 and %d\n", FFT_MAX_LOG2N);
+      return 1;
+   }
+   size = 1 << max_log2n;
+   x15 = malloc(size * sizeof(*x15));
+   y15 = malloc(size * sizeof(*y15));
+   x31 = malloc(size * sizeof(*x31));
+   y31 = malloc(size * sizeof(*y31));
+   in = malloc(size * sizeof(*in));
+   ref = malloc(size * sizeof(*ref));
+   got = malloc(size * sizeof(*got));
+   if (!x15 || !y15 || !x31 || !y31 || !in || !ref || !got)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < size; i++)
+   {
+      x15[i].a = lround(2048.0 + 1500.0 * sin(2.0 * M_PI * 0.1234 * i) +
+                        100.0 * ((double)rand() / RAND_MAX - 0.5));
+      x15[i].b = 0;
+      x31[i].a = x15[i].a;
+      x31[i].b = 0;
+      in[i].a = x15[i].a;
+      in[i].b = 0.0;
+   }
+
+   printf("%10s %10s %12s %10s %12s %12s\n", "N", "Q15 SNR", "time",
+          "Q31 SNR", "time", "double");
+   for (m = 4; m <= max_log2n; m++)
+   {
+      n = 1 << m;
+      plan = fft_fixed_plan_create(n, 0);
+      dplan = fft_plan_create(n, FFT_SIMD);
+      if (!plan || !dplan || fft_execute(dplan, in, ref) < 0)
+      {
+         printf("%10d failed\n", n);
+         fft_fixed_plan_destroy(plan);
+         fft_plan_destroy(dplan);
+         continue;
+      }
+      fft_plan_destroy(dplan);
+
+      reps = (1 << 22) / n;
+      t15 = t31 = -1.0;
+      for (i = 0; i < 3; i++)
+      {
+         t = now();
+         for (r = 0; r < reps; r++)
+            e15 = fft_execute_q15(plan, x15, y15);
+         t = (now() - t) / reps;
+         if (t15 < 0 || t < t15)
+            t15 = t;
+         t = now();
+         for (r = 0; r < reps; r++)
+            e31 = fft_execute_q31(plan, x31, y31);
+         t = (now() - t) / reps;
+         if (t31 < 0 || t < t31)
+            t31 = t;
+      }
+      fft_fixed_plan_destroy(plan);
+
+      for (i = 0; i < n; i++)
+      {
+         got[i].a = ldexp(y15[i].a, e15);
+         got[i].b = ldexp(y15[i].b, e15);
+      }
+      snr15 = snr_db(ref, got, n);
+      for (i = 0; i < n; i++)
+      {
+         got[i].a = ldexp(y31[i].a, e31);
+         got[i].b = ldexp(y31[i].b, e31);
+      }
+      snr31 = snr_db(ref, got, n);
+      printf("%10d %7.1f dB %10.2fus %7.1f dB %10.2fus %10.2fus\n", n, snr15,
+             t15 * 1e6, snr31, t31 * 1e6,
+             time_kernel(n, FFT_SIMD, 1, in, ref) * 1e6);
+   }
+   free(x15);
+   free(y15);
+   free(x31);
+   free(y31);
+   free(in);
+   free(ref);
+   free(got);
+   return 0;
+}
+
+/* Time per frame of a Goertzel bank, best of three, or -1 on failure.
+   The bins are written to out. */
+static double time_goertzel(int n, const int *bins, int nbins, int method,
+                            const double *x, struct Complex *out)
+{
+   fft_goertzel *g;
+   double best = -1.0, t;
+   int reps, r, trial;
+
+   g = fft_goertzel_create(n, bins, nbins, method);
+   if (!g)
+      return -1.0;
+   reps = (1 << 22) / n / nbins + 1;
+   fft_goertzel_process(g, x, out);
+   for (trial = 0; trial < 3; trial++)
+   {
+      t = now();
+      for (r = 0; r < reps; r++)
+         fft_goertzel_process(g, x, out);
+      t = (now() - t) / reps;
+      if (best < 0 || t < best)
+         best = t;
+   }
+   fft_goertzel_destroy(g);
+   return best;
+}
+
+/* Goertzel bank against the real FFT, see -g above. */
+static int bench_goertzel(int n, int max_bins)
+{
+   struct Complex *yg, *yf;
+   fft_goertzel *g;
+   double *x, tg, tf, err, d;
+   int *bins;
+   int b, i;
+
+   if (n < 2 || n > FFT_MAX_SIZE || n % 2 != 0 || max_bins < 1 ||
+       max_bins > n / 2 + 1)
+   {
+      printf("n must be even and max_bins from 1 to n/2 + 1\n");
+      return 1;
+   }
+   x = malloc(n * sizeof(*x));
+   bins = malloc(max_bins * sizeof(*bins));
+   yg = malloc(max_bins * sizeof(*yg));
+   yf = malloc(max_bins * sizeof(*yf));
+   if (!x || !bins || !yg || !yf)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < n; i++)
+      x[i] = 2048.0 + 1500.0 * sin(2.0 * M_PI * 0.1234 * i) +
+             100.0 * ((double)rand() / RAND_MAX - 0.5);
+   for (b = 0; b < max_bins; b++)
+      bins[b] = (int)((long long)b * 7919 % (n / 2 + 1));
+
+   printf("N = %d\n%6s %12s %12s %8s %12s\n", n, "bins", "goertzel", "fft",
+          "auto", "max diff");
+   for (b = 1; b <= max_bins; b++)
+   {
+      tg = time_goertzel(n, bins, b, FFT_GOERTZEL_FILTER, x, yg);
+      tf = time_goertzel(n, bins, b, FFT_GOERTZEL_FFT, x, yf);
+      g = fft_goertzel_create(n, bins, b, FFT_GOERTZEL_AUTO);
+      if (tg < 0 || tf < 0 || !g)
+      {
+         printf("Out of memory\n");
+         return 1;
+      }
+      err = 0.0;
+      for (i = 0; i < b; i++)
+      {
+         d = hypot(yg[i].a - yf[i].a, yg[i].b - yf[i].b);
+         if (d > err)
+            err = d;
+      }
+      printf("%6d %10.2fus %10.2fus %8s %12g\n", b, tg * 1e6, tf * 1e6,
+             fft_goertzel_uses_fft(g) ? "fft" : "filter", err);
+      fft_goertzel_destroy(g);
+   }
+   free(x);
+   free(bins);
+   free(yg);
+   free(yf);
+   return 0;
+}
+
+/* Sliding DFT speed and drift, see -d above. */
+static int bench_sdft(int n, int samples)
+{
+   static const struct { const char *name; int one_bin, anchor; } runs[] =
+   {
+      { "all bins", 0, 0 },
+      { "all bins, no anchor", 0, INT_MAX },
+      { "1 bin", 1, 0 },
+      { "1 bin, no anchor", 1, INT_MAX },
+   };
+   struct Complex *ref, *got;
+   fft_real_plan *plan;
+   fft_sdft *s;
+   double *x, t, err, peak, d;
+   int bin = n / 8, r, i, nb;
+
+   if (n < 2 || n > FFT_MAX_SIZE || n % 2 != 0 || samples < n)
+   {
+      printf("n must be even and samples at least n\n");
+      return 1;
+   }
+   x = malloc(samples * sizeof(*x));
+   ref = malloc((n / 2 + 1) * sizeof(*ref));
+   got = malloc((n / 2 + 1) * sizeof(*got));
+   plan = fft_real_plan_create(n, FFT_SIMD);
+   if (!x || !ref || !got || !plan)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < samples; i++)
+      x[i] = 2048.0 + 1500.0 * sin(2.0 * M_PI * 0.1234 * i) +
+             100.0 * ((double)rand() / RAND_MAX - 0.5);
+   fft_execute_r2c(plan, x + samples - n, ref);
+   peak = 0.0;
+   for (i = 0; i <= n / 2; i++)
+      if (hypot(ref[i].a, ref[i].b) > peak)
+         peak = hypot(ref[i].a, ref[i].b);
+
+   printf("N = %d, %d samples\n", n, samples);
+   for (r = 0; r < (int)(sizeof(runs) / sizeof(runs[0])); r++)
+   {
+      s = fft_sdft_create(n, runs[r].one_bin ? &bin : NULL, 1,
+                          runs[r].anchor);
+      if (!s)
+      {
+         printf("Out of memory\n");
+         return 1;
+      }
+      t = now();
+      fft_sdft_process(s, x, samples);
+      t = (now() - t) / samples;
+      fft_sdft_spectrum(s, got);
+      nb = fft_sdft_bins(s);
+      err = 0.0;
+      for (i = 0; i < nb; i++)
+      {
+         d = runs[r].one_bin ? hypot(got[0].a - ref[bin].a,
+                                     got[0].b - ref[bin].b)
+                             : hypot(got[i].a - ref[i].a, got[i].b - ref[i].b);
+         if (d > err)
+            err = d;
+      }
+      printf("  %-20s %10.1fns a sample   error %g of peak\n", runs[r].name,
+             t * 1e9, err / peak);
+      fft_sdft_destroy(s);
+   }
+   free(x);
+   free(ref);
+   free(got);
+   fft_real_plan_destroy(plan);
+   return 0;
+}
+
+/* Window functions, see -W above. */
+static int bench_window(int n)
+{
+   static const char *names[] =
+   {
+      "rect", "hann", "hamming", "blackman", "blackman-harris", "flattop",
+      "kaiser"
+   };
+   const struct fft_window *win;
+   fft_real_plan *plan;
+   struct Complex *X, *work;
+   double *x, *tmp, t, tsep, tfused, amp, leak, a;
+   int frames = (1 << 22) / n + 1, type, f, i, trial, tone = n / 8;
+
+   if (n < 64 || n > FFT_MAX_SIZE || n % 2 != 0)
+   {
+      printf("n must be even and at least 64\n");
+      return 1;
+   }
+   plan = fft_real_plan_create(n, FFT_SIMD);
+   x = malloc(n * sizeof(*x));
+   tmp = malloc(n * sizeof(*tmp));
+   X = malloc((n / 2 + 1) * sizeof(*X));
+   work = plan ? malloc(fft_real_work_size(plan) * sizeof(*work)) : NULL;
+   if (!x || !tmp || !X || !work)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   // Half way between two bins, where the windows lose the most.
+   for (i = 0; i < n; i++)
+      x[i] = cos(2.0 * M_PI * (tone + 0.5) * i / n);
+
+   fft_execute_r2c_work(plan, x, X, work);   // warm up
+   printf("N = %d, tone of amplitude 1 at bin %d.5\n", n, tone);
+   printf("  %-16s %8s %8s %9s %9s %12s %12s\n", "window", "gain", "ENBW",
+          "peak dB", "leak dB", "separate", "fused");
+   for (type = FFT_WINDOW_RECT; type <= FFT_WINDOW_KAISER; type++)
+   {
+      win = fft_window_get(type, n, 0.0);
+      if (!win)
+      {
+         printf("Out of memory\n");
+         return 1;
+      }
+      tsep = tfused = 1e30;
+      for (trial = 0; trial < 3; trial++)
+      {
+         t = now();
+         for (f = 0; f < frames; f++)
+         {
+            for (i = 0; i < n; i++)
+               tmp[i] = x[i] * win->w[i];
+            fft_execute_r2c_work(plan, tmp, X, work);
+         }
+         t = now() - t;
+         if (t < tsep)
+            tsep = t;
+         t = now();
+         for (f = 0; f < frames; f++)
+            fft_execute_r2c_window_work(plan, x, win->w, X, work);
+         t = now() - t;
+         if (t < tfused)
+            tfused = t;
+      }
+
+      // The tone's amplitude from its largest bin, and the most that leaks
+      // into bins 16 or more away from it.
+      amp = leak = 0.0;
+      for (i = 0; i <= n / 2; i++)
+      {
+         a = 2.0 * hypot(X[i].a, X[i].b) / (n * win->coherent_gain);
+         if (a > amp)
+            amp = a;
+         if (abs(i - tone) >= 16 && a > leak)
+            leak = a;
+      }
+      printf("  %-16s %8.4f %8.3f %9.2f %9.1f %10.3fus %10.3fus\n",
+             names[type], win->coherent_gain, win->enbw, 20 * log10(amp),
+             20 * log10(leak), tsep / frames * 1e6, tfused / frames * 1e6);
+   }
+   free(x);
+   free(tmp);
+   free(X);
+   free(work);
+   fft_real_plan_destroy(plan);
+   return 0;
+}
+
+/* Text capture parsing, see -p above. */
+static int bench_parse(const char *path)
+{
+   const char *name = path ? path : "fft_parse.txt";
+   struct adc_text text;
+   struct stat st;
+   double *old = NULL, *grown, t_old, t_new, err = 0.0, size;
+   int64_t count = 0, cap = 0, i;
+   float fm;
+   FILE *fp;
+
+   if (!path)
+   {
+      fp = fopen(name, "w");
+      if (!fp)
+      {
+         printf("Could not write %s\n", name);
+         return 1;
+      }
+      for (size = 0; size < 100e6; )
+         size += fprintf(fp, "%d\n", rand() % 4096);
+      fclose(fp);
+   }
+   if (stat(name, &st) < 0)
+   {
+      printf("Not Opened\n");
+      return 1;
+   }
+   size = st.st_size;
+
+   // The loop main() had, keeping every sample.
+   t_old = now();
+   fp = fopen(name, "r");
+   if (!fp)
+   {
+      printf("Not Opened\n");
+      return 1;
+   }
+   while (fscanf(fp, "%f", &fm) == 1)
+   {
+      if (count == cap)
+      {
+         cap = cap ? 2 * cap : 1 << 16;
+         grown = realloc(old, cap * sizeof(*old));
+         if (!grown)
+         {
+            printf("Out of memory\n");
+            return 1;
+         }
+         old = grown;
+      }
+      old[count++] = fm * 3.3 / 4095;
+   }
+   fclose(fp);
+   t_old = now() - t_old;
+
+   t_new = now();
+   if (adc_text_read(name, 3.3 / 4095, &text) < 0)
+   {
+      printf("Not Opened\n");
+      return 1;
+   }
+   t_new = now() - t_new;
+   if (!path)
+      remove(name);
+
+   for (i = 0; i < count && i < text.count; i++)
+      if (fabs(old[i] - text.samples[i]) > err)
+         err = fabs(old[i] - text.samples[i]);
+   printf("%s: %lld samples", name, (long long)text.count);
+   if (text.bad_lines > 0)
+      printf(", %lld malformed lines from line %lld",
+             (long long)text.bad_lines, (long long)text.first_bad);
+   printf("\n  %-14s %8.3fs %8.1f MB/s %10lld samples\n", "fscanf", t_old,
+          size / t_old / 1e6, (long long)count);
+   printf("  %-14s %8.3fs %8.1f MB/s   %.1fx, largest difference %g V\n",
+          "adc_text_read", t_new, size / t_new / 1e6, t_old / t_new, err);
+   free(old);
+   adc_text_free(&text);
+   return 0;
+}
+
+/* Name of the kernels entry matching plan flags, for -w. */
+static const char *kernel_name(int flags)
+{
+   int k;
+
+   // The codelets are listed once, whatever instruction set they run on.
+   if ((flags & FFT_KERNEL_MASK) == FFT_CODELET)
+      flags = FFT_CODELET;
+   for (k = 0; k < N_KERNELS; k++)
+      if (!kernels[k].single && kernels[k].flags == flags)
+         return kernels[k].name;
+   return "?";
+}
+
+/* FFT_MEASURE plans for 16 .. 2^max_log2n points, with and saving wisdom. */
+static int bench_wisdom(int max_log2n, const char *path)
+{
+   fft_plan *plan;
+   double t;
+   int m, loaded;
+
+   if (max_log2n < 4 || max_log2n > FFT_MAX_LOG2N)
+   {
+      printf("max_log2n must be between 4 and %d\n", FFT_MAX_LOG2N);
+      return 1;
+   }
+   loaded = fft_wisdom_load(path);
+   printf("%d entries loaded from %s\n", loaded < 0 ? 0 : loaded, path);
+   printf("%10s %10s %12s\n", "N", "kernel", "plan time");
+   for (m = 4; m <= max_log2n; m++)
+   {
+      t = now();
+      plan = fft_plan_create_threaded(1 << m, FFT_MEASURE, 0);
+      t = now() - t;
+      if (!plan)
+      {
+         printf("%10d %10s\n", 1 << m, "failed");
+         continue;
+      }
+      printf("%10d %10s %10.3fms\n", 1 << m,
+             kernel_name(fft_plan_flags(plan)), t * 1e3);
+      fft_plan_destroy(plan);
+   }
+   if (fft_wisdom_save(path) < 0)
+   {
+      printf("Could not write %s\n", path);
+      return 1;
+   }
+   return 0;
+}
+
+int main(int argc, char **argv)
+{
+   struct Complex *in, *out;
+   int max_log2n = 22;
+   int m, n, i, k, best;
+   double t, tbest;
+
+   if (argc > 2 && strcmp(argv[1], "-c") == 0)
+      return compare_kernels(argv[2]);
+   if (argc > 3 && strcmp(argv[1], "-b") == 0)
+      return bench_batch(atoi(argv[2]), atoi(argv[3]),
+                         argc > 4 ? atoi(argv[4]) : 0);
+   if (argc > 2 && strcmp(argv[1], "-n") == 0)
+      return bench_lengths(argc - 2, argv + 2);
+   if (argc > 2 && strcmp(argv[1], "-f") == 0)
+      return bench_conv(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 0);
+   if (argc > 3 && strcmp(argv[1], "-u") == 0)
+      return bench_cufft(atoi(argv[2]), atoi(argv[3]));
+   if (argc > 1 && strcmp(argv[1], "-q") == 0)
+      return bench_fixed(argc > 2 ? atoi(argv[2]) : 16);
+   if (argc > 2 && strcmp(argv[1], "-d") == 0)
+      return bench_sdft(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 1 << 20);
+   if (argc > 2 && strcmp(argv[1], "-g") == 0)
+      return bench_goertzel(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 16);
+   if (argc > 2 && strcmp(argv[1], "-w") == 0)
+      return bench_wisdom(atoi(argv[2]), argc > 3 ? argv[3] : "fft_wisdom");
+   if (argc > 3 && strcmp(argv[1], "-m") == 0)
+      return bench_multi(atoi(argv[2]), atoi(argv[3]),
+                         argc > 4 ? atoi(argv[4]) : 0);
+   if (argc > 2 && strcmp(argv[1], "-W") == 0)
+      return bench_window(atoi(argv[2]));
+   if (argc > 1 && strcmp(argv[1], "-p") == 0)
+      return bench_parse(argc > 2 ? argv[2] : NULL);
+   if (argc > 2 && strcmp(argv[1], "-t") == 0)
+      return bench_threads(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 0);
+   if (argc > 1)
+      max_log2n = atoi(argv[1]);
+   if (max_log2n < 1 || max_log2n > FFT_MAX_LOG2N)
+   {
+      printf("max_log2n must be between 1 and %d\n", FFT_MAX_LOG2N);
+      return 1;
+   }
+
+   in = malloc(((size_t)1 << max_log2n) * sizeof(*in));
+   out = malloc(((size_t)1 << max_log2n) * sizeof(*out));
+   if (!in || !out)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < (1 << max_log2n); i++)
+   {
+      in[i].a = (double)rand() / RAND_MAX - 0.5;
+      in[i].b = (double)rand() / RAND_MAX - 0.5;
+   }
+
+   printf("%10s", "N");
+   for (k = 0; k < N_KERNELS; k++)
+      printf(" %12s %8s", kernels[k].name, "MFLOPS");
+   printf("  best\n");
+
+   for (m = 4; m <= max_log2n; m++)
+   {
+      n = 1 << m;
+      printf("%10d", n);
+      best = -1;
+      tbest = 0.0;
+      for (k = 0; k < N_KERNELS; k++)
+      {
+         if (kernels[k].single)
+            t = time_float(n, kernels[k].flags, in);
+         else
+            t = time_kernel(n, kernels[k].flags, 1, in, out);
+         if (t < 0)
+         {
+            printf(" %12s %8s", "-", "-");
+            continue;
+         }
+         if (best < 0 || t < tbest)
+         {
+            best = k;
+            tbest = t;
+         }
+         printf(" %10.2fus %8.0f", t * 1e6, 5.0 * n * m / t * 1e-6);
+      }
+      printf("  %s\n", best < 0 ? "-" : kernels[best].name);
+   }
+
+   free(in);
+   free(out);
+   return 0;
+}
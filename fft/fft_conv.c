@@ -0,0 +1,166 @@
+/*
+ * fft_conv.c
+ *
+ * Streaming FIR filtering by fast convolution.  The input arrives in
+ * blocks of B samples and the filter has T taps.  Each block costs one
+ * real FFT and one inverse real FFT of N points, N the first power of two
+ * >= B + T - 1, plus N/2 + 1 complex multiplies, against B * T multiplies
+ * for direct convolution.
+ *
+ * The filter spectrum H is computed once when the filter is created, with
+ * the 1/N of the inverse transform folded into it.
+ *
+ *   Overlap-add: the block is zero padded to N and filtered, which gives
+ *   B + T - 1 output samples.  The first B are added to what earlier blocks
+ *   left over and returned; the rest are kept for the next blocks.
+ *
+ *   Overlap-save: the transform covers the last N input samples, so the
+ *   block plus the N - B before it.  The first N - B outputs are wrapped
+ *   around by the circular convolution and thrown away; the last B are
+ *   exact because N - B >= T - 1.
+ *
+ * The two give the same output up to rounding.  Overlap-save needs no
+ * add pass over the output and keeps its state on the input side.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "fft_internal.h"
+
+struct fft_conv
+{
+   int taps, block, n;
+   int method;                // FFT_CONV_OLA or FFT_CONV_OLS
+   fft_real_plan *plan;
+   struct Complex *H;         // filter spectrum / n, n/2 + 1 bins
+   struct Complex *X;         // spectrum of the current block
+   struct Complex *work;      // scratch for the real transforms
+   double *x;                 // n time-domain samples
+   double *state;             // OLA: pending output, OLS: past input
+};
+
+
+fft_conv *fft_conv_create(const double *h, int taps, int block, int method)
+{
+   fft_conv *c;
+   int n = 2, k;
+
+   if (!h || taps < 1 || taps > FFT_MAX_SIZE || block < 0 ||
+       (method != FFT_CONV_OLA && method != FFT_CONV_OLS))
+      return NULL;
+   if (block == 0)
+   {
+      // About 4 taps' worth of FFT per block keeps the per-sample cost
+      // near its minimum without making the blocks too long.
+      while (n < 4 * taps && n < FFT_MAX_SIZE)
+         n *= 2;
+      block = n - taps + 1;
+   }
+   if (block < 1 || (long long)block + taps - 1 > FFT_MAX_SIZE)
+      return NULL;
+   while (n < block + taps - 1)
+      n *= 2;
+
+   c = calloc(1, sizeof(*c));
+   if (!c)
+      return NULL;
+   c->taps = taps;
+   c->block = block;
+   c->n = n;
+   c->method = method;
+   c->plan = fft_real_plan_create(n, FFT_SIMD);
+   c->H = malloc((n / 2 + 1) * sizeof(*c->H));
+   c->X = malloc((n / 2 + 1) * sizeof(*c->X));
+   c->x = malloc(n * sizeof(*c->x));
+   c->state = calloc(n, sizeof(*c->state));
+   if (c->plan)
+      c->work = malloc(fft_real_work_size(c->plan) * sizeof(*c->work));
+   if (!c->plan || !c->H || !c->X || !c->x || !c->state || !c->work)
+   {
+      fft_conv_destroy(c);
+      return NULL;
+   }
+
+   memcpy(c->x, h, taps * sizeof(*h));
+   memset(c->x + taps, 0, (n - taps) * sizeof(*h));
+   fft_execute_r2c_work(c->plan, c->x, c->H, c->work);
+   for (k = 0; k <= n / 2; k++)
+   {
+      c->H[k].a /= n;
+      c->H[k].b /= n;
+   }
+   return c;
+}
+
+void fft_conv_destroy(fft_conv *c)
+{
+   if (!c)
+      return;
+   fft_real_plan_destroy(c->plan);
+   free(c->H);
+   free(c->X);
+   free(c->work);
+   free(c->x);
+   free(c->state);
+   free(c);
+}
+
+int fft_conv_block_size(const fft_conv *c)
+{
+   return c->block;
+}
+
+int fft_conv_fft_size(const fft_conv *c)
+{
+   return c->n;
+}
+
+void fft_conv_reset(fft_conv *c)
+{
+   memset(c->state, 0, c->n * sizeof(*c->state));
+}
+
+/* x = IFFT(FFT(x) * H), all n points. */
+static void filter(fft_conv *c)
+{
+   struct Complex *X = c->X, *H = c->H;
+   double re;
+   int k;
+
+   fft_execute_r2c_work(c->plan, c->x, X, c->work);
+   for (k = 0; k <= c->n / 2; k++)
+   {
+      re = X[k].a * H[k].a - X[k].b * H[k].b;
+      X[k].b = X[k].a * H[k].b + X[k].b * H[k].a;
+      X[k].a = re;
+   }
+   fft_execute_c2r_work(c->plan, X, c->x, c->work);
+}
+
+void fft_conv_process(fft_conv *c, const double *in, double *out)
+{
+   int n = c->n, B = c->block, k;
+
+   if (c->method == FFT_CONV_OLA)
+   {
+      memcpy(c->x, in, B * sizeof(*in));
+      memset(c->x + B, 0, (n - B) * sizeof(*c->x));
+      filter(c);
+      // state holds the tails of earlier blocks, already lined up with
+      // this one.
+      for (k = 0; k < B; k++)
+         out[k] = c->state[k] + c->x[k];
+      for (k = B; k < n; k++)
+         c->state[k - B] = c->state[k] + c->x[k];
+      memset(c->state + n - B, 0, B * sizeof(*c->state));
+   }
+   else
+   {
+      // state holds the last n - B input samples.
+      memcpy(c->x, c->state, (n - B) * sizeof(*c->x));
+      memcpy(c->x + n - B, in, B * sizeof(*in));
+      memcpy(c->state, c->x + B, (n - B) * sizeof(*c->state));
+      filter(c);
+      memcpy(out, c->x + n - B, B * sizeof(*out));
+   }
+}
@@ -0,0 +1,260 @@
+/*
+ * fft_fixed.c
+ *
+ * Fixed-point complex FFT in Q15 (int16_t) and Q31 (int32_t), for checking
+ * an integer firmware FFT on the host and for transforming ADC counts
+ * without converting them to double.  A Q15 frame takes 4 bytes a point
+ * against 16 for struct Complex.
+ *
+ * The transform is radix-2 decimation in time: a bit-reversed copy, then
+ * log2(n) passes of
+ *
+ *    t = W * b,   a' = (a + t) >> s,   b' = (a - t) >> s
+ *
+ * Block floating point keeps it in range.  Before each pass the shift s is
+ * picked from the largest component M left by the previous one: a pass can
+ * grow a component by at most (1 + sqrt(2)) M, so s = 0 while that still
+ * fits, 1 while half of it fits and 2 otherwise.  The input is first
+ * shifted up as far as it goes with s = 0 for the first pass.  The shifts
+ * add up to the block exponent the execute call returns, and the true
+ * spectrum is out * 2^exponent.  Quiet signals are left at full precision
+ * and loud ones lose a bit only where a pass would overflow.
+ *
+ * The arithmetic is exactly what a Q15/Q31 DSP routine would do, so a
+ * port with the same rules gives the same bits:
+ *
+ *   - twiddles are round(cos * 2^15) and round(-sin * 2^15) (2^31 for Q31),
+ *     with +1.0 saturated to 0x7fff (0x7fffffff)
+ *   - W * b is formed in 32 bits (64 for Q31), rounded by adding 2^14
+ *     (2^30) and shifted right arithmetically by 15 (31)
+ *   - a +- t is formed in 32 (64) bits and rounded by adding 2^(s-1)
+ *     before the arithmetic shift right by s
+ *
+ * Each pass that shifts adds half a bit of rounding noise on average, so
+ * the Q15 SNR drops about 3 dB every time n doubles: 55 dB at n = 1024 on
+ * 12-bit ADC data, against 150 dB for Q31.  "./fft_bench -q" prints the
+ * SNR and time for each size.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "fft.h"
+
+/* Largest component a pass can take at each shift without overflowing,
+   (2^15 - 2) / (1 + sqrt(2)) and (2^16 - 3) / (1 + sqrt(2)), and the
+   same for 31 bits. */
+#define Q15_PEAK_SHIFT0  13572
+#define Q15_PEAK_SHIFT1  27144
+#define Q31_PEAK_SHIFT0  889516851
+#define Q31_PEAK_SHIFT1  1779033702
+
+struct fft_fixed_plan
+{
+   int n;
+   int *rev;                  // rev[i] = bitrev(i)
+   struct ComplexQ15 *w15;    // w[k] = e^(-i*2*pi*k/n), k < n/2 (+i inverse)
+   struct ComplexQ31 *w31;
+};
+
+
+/* x * 2^bits rounded, with +1.0 saturated. */
+static long long to_fixed(double x, int bits)
+{
+   long long one = 1LL << bits, v = llround(x * one);
+
+   return v >= one ? one - 1 : v;
+}
+
+fft_fixed_plan *fft_fixed_plan_create(int n, int flags)
+{
+   fft_fixed_plan *plan;
+   double a;
+   int bits = 0, i, k;
+
+   if (n < 1 || n > FFT_MAX_SIZE || (n & (n - 1)) != 0)
+      return NULL;
+   plan = calloc(1, sizeof(*plan));
+   if (!plan)
+      return NULL;
+   plan->n = n;
+   plan->rev = malloc(n * sizeof(*plan->rev));
+   plan->w15 = malloc((n / 2 + 1) * sizeof(*plan->w15));
+   plan->w31 = malloc((n / 2 + 1) * sizeof(*plan->w31));
+   if (!plan->rev || !plan->w15 || !plan->w31)
+   {
+      fft_fixed_plan_destroy(plan);
+      return NULL;
+   }
+
+   while ((1 << bits) < n)
+      bits++;
+   for (i = 0; i < n; i++)
+   {
+      plan->rev[i] = 0;
+      for (k = 0; k < bits; k++)
+         if (i & (1 << k))
+            plan->rev[i] |= 1 << (bits - 1 - k);
+   }
+   for (k = 0; k < n / 2; k++)
+   {
+      a = 2.0 * M_PI * k / n;
+      if (!(flags & FFT_INVERSE))
+         a = -a;
+      plan->w15[k].a = to_fixed(cos(a), 15);
+      plan->w15[k].b = to_fixed(sin(a), 15);
+      plan->w31[k].a = to_fixed(cos(a), 31);
+      plan->w31[k].b = to_fixed(sin(a), 31);
+   }
+   return plan;
+}
+
+void fft_fixed_plan_destroy(fft_fixed_plan *plan)
+{
+   if (!plan)
+      return;
+   free(plan->rev);
+   free(plan->w15);
+   free(plan->w31);
+   free(plan);
+}
+
+/* The larger of peak, |a| and |b|. */
+static inline int64_t max_abs(int64_t peak, int64_t a, int64_t b)
+{
+   if (a < 0)
+      a = -a;
+   if (b < 0)
+      b = -b;
+   if (a > peak)
+      peak = a;
+   return b > peak ? b : peak;
+}
+
+int fft_execute_q15(const fft_fixed_plan *plan, const struct ComplexQ15 *in,
+                    struct ComplexQ15 *out)
+{
+   const struct ComplexQ15 *w = plan->w15;
+   struct ComplexQ15 t, *x, *y;
+   int n = plan->n, exponent = 0, half, step, s, i, j, k;
+   int32_t peak = 0, ta, tb, va, vb, r;
+
+   if (in != out)
+      for (i = 0; i < n; i++)
+         out[plan->rev[i]] = in[i];
+   else
+      for (i = 0; i < n; i++)
+         if (i < plan->rev[i])
+         {
+            t = out[i];
+            out[i] = out[plan->rev[i]];
+            out[plan->rev[i]] = t;
+         }
+
+   for (i = 0; i < n; i++)
+      peak = max_abs(peak, out[i].a, out[i].b);
+   if (peak == 0)
+      return 0;
+   // Small inputs are scaled up, so the first pass keeps every bit.
+   while (peak * 2 <= Q15_PEAK_SHIFT0)
+   {
+      peak <<= 1;
+      exponent--;
+   }
+   if (exponent < 0)
+      for (i = 0; i < n; i++)
+      {
+         out[i].a = out[i].a * (1 << -exponent);
+         out[i].b = out[i].b * (1 << -exponent);
+      }
+
+   for (half = 1; half < n; half *= 2)
+   {
+      step = n / (2 * half);
+      s = peak <= Q15_PEAK_SHIFT0 ? 0 : peak <= Q15_PEAK_SHIFT1 ? 1 : 2;
+      r = s ? 1 << (s - 1) : 0;
+      exponent += s;
+      peak = 0;
+      for (j = 0; j < n; j += 2 * half)
+         for (k = 0; k < half; k++)
+         {
+            x = out + j + k;
+            y = x + half;
+            ta = (y->a * w[k * step].a - y->b * w[k * step].b + 0x4000) >> 15;
+            tb = (y->a * w[k * step].b + y->b * w[k * step].a + 0x4000) >> 15;
+            va = x->a;
+            vb = x->b;
+            x->a = (va + ta + r) >> s;
+            x->b = (vb + tb + r) >> s;
+            y->a = (va - ta + r) >> s;
+            y->b = (vb - tb + r) >> s;
+            peak = max_abs(peak, x->a, x->b);
+            peak = max_abs(peak, y->a, y->b);
+         }
+   }
+   return exponent;
+}
+
+int fft_execute_q31(const fft_fixed_plan *plan, const struct ComplexQ31 *in,
+                    struct ComplexQ31 *out)
+{
+   const struct ComplexQ31 *w = plan->w31;
+   struct ComplexQ31 t, *x, *y;
+   int n = plan->n, exponent = 0, half, step, s, i, j, k;
+   int64_t peak = 0, ta, tb, va, vb, r;
+
+   if (in != out)
+      for (i = 0; i < n; i++)
+         out[plan->rev[i]] = in[i];
+   else
+      for (i = 0; i < n; i++)
+         if (i < plan->rev[i])
+         {
+            t = out[i];
+            out[i] = out[plan->rev[i]];
+            out[plan->rev[i]] = t;
+         }
+
+   for (i = 0; i < n; i++)
+      peak = max_abs(peak, out[i].a, out[i].b);
+   if (peak == 0)
+      return 0;
+   while (peak * 2 <= Q31_PEAK_SHIFT0)
+   {
+      peak <<= 1;
+      exponent--;
+   }
+   if (exponent < 0)
+      for (i = 0; i < n; i++)
+      {
+         out[i].a = (int32_t)((int64_t)out[i].a * ((int64_t)1 << -exponent));
+         out[i].b = (int32_t)((int64_t)out[i].b * ((int64_t)1 << -exponent));
+      }
+
+   for (half = 1; half < n; half *= 2)
+   {
+      step = n / (2 * half);
+      s = peak <= Q31_PEAK_SHIFT0 ? 0 : peak <= Q31_PEAK_SHIFT1 ? 1 : 2;
+      r = s ? (int64_t)1 << (s - 1) : 0;
+      exponent += s;
+      peak = 0;
+      for (j = 0; j < n; j += 2 * half)
+         for (k = 0; k < half; k++)
+         {
+            x = out + j + k;
+            y = x + half;
+            ta = ((int64_t)y->a * w[k * step].a -
+                  (int64_t)y->b * w[k * step].b + 0x40000000) >> 31;
+            tb = ((int64_t)y->a * w[k * step].b +
+                  (int64_t)y->b * w[k * step].a + 0x40000000) >> 31;
+            va = x->a;
+            vb = x->b;
+            x->a = (int32_t)((va + ta + r) >> s);
+            x->b = (int32_t)((vb + tb + r) >> s);
+            y->a = (int32_t)((va - ta + r) >> s);
+            y->b = (int32_t)((vb - tb + r) >> s);
+            peak = max_abs(peak, x->a, x->b);
+            peak = max_abs(peak, y->a, y->b);
+         }
+   }
+   return exponent;
+}
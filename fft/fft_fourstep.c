@@ -0,0 +1,243 @@
+/*
+ * fft_fourstep.c
+ *
+ * The FFT_FOUR_STEP kernel: an n-point transform done as n = n1 * n2 with
+ * row FFTs and transposes (Bailey's "six-step" variant), for sizes where
+ * the single-array kernels spend their time waiting on memory.
+ *
+ * With x read as an n1 x n2 matrix, x[n2*a + b]:
+ *
+ *   1. transpose to n2 x n1, so each column of x becomes a row
+ *   2. n1-point FFT of every row, then scale element (b, k1) by W^(b*k1),
+ *      W = e^(-i*2*pi/n)
+ *   3. transpose back to n1 x n2
+ *   4. n2-point FFT of every row
+ *   5. transpose to n2 x n1, which is X in natural order
+ *
+ * Every row FFT works on n1 or n2 ~ sqrt(n) contiguous points, which fit
+ * in cache, and uses the FFT_SIMD kernel.  The transposes go tile by tile
+ * so that both sides are touched a cache line at a time.  Rows and tiles
+ * are independent, so each step is split over the plan's thread pool.
+ *
+ * The inverse is the same with inverse row plans and W conjugated.
+ *
+ * W^(b*k1) comes from two tables of about sqrt(n) entries, W^lo and
+ * W^(hi*2^s), multiplied together, rather than one table as big as the
+ * data.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft_internal.h"
+
+#define TILE 32   // 32x32 complex doubles = 16 KB per tile
+
+struct four_step_job
+{
+   const fft_plan *plan;
+   int stage;
+   const struct Complex *src;
+   struct Complex *dst;
+   struct Complex *work;    // per-slot row scratch starts here
+};
+
+enum { STAGE_TRANSPOSE_12, STAGE_ROWS_1, STAGE_TRANSPOSE_21, STAGE_ROWS_2 };
+
+
+int fft_four_step_init(fft_plan *plan, int flags, int nthreads)
+{
+   int s = (plan->m + 1) / 2;
+   double sign = plan->inverse ? 1.0 : -1.0;
+   int i;
+
+   // n1 >= n2 so that the twiddled rows are the longer ones.
+   plan->n1 = 1 << s;
+   plan->n2 = plan->n / plan->n1;
+   flags &= FFT_ISA_MASK | FFT_INVERSE;
+   plan->row1 = fft_plan_create(plan->n1, FFT_SIMD | flags);
+   plan->row2 = fft_plan_create(plan->n2, FFT_SIMD | flags);
+   if (!plan->row1 || !plan->row2)
+      return -1;
+
+   plan->lo_bits = s;
+   plan->tw_lo = malloc((1 << s) * sizeof(*plan->tw_lo));
+   plan->tw_hi = malloc(((plan->n >> s) + 1) * sizeof(*plan->tw_hi));
+   if (!plan->tw_lo || !plan->tw_hi)
+      return -1;
+   for (i = 0; i < (1 << s); i++)
+   {
+      plan->tw_lo[i].a = cos(2.0 * M_PI * i / plan->n);
+      plan->tw_lo[i].b = sign * sin(2.0 * M_PI * i / plan->n);
+   }
+   for (i = 0; i <= (plan->n >> s); i++)
+   {
+      plan->tw_hi[i].a = cos(2.0 * M_PI * ((double)i * (1 << s)) / plan->n);
+      plan->tw_hi[i].b = sign * sin(2.0 * M_PI * ((double)i * (1 << s)) / plan->n);
+   }
+
+   if (nthreads != 1)
+   {
+      plan->pool = fft_pool_create(nthreads);
+      if (!plan->pool)
+         return -1;
+   }
+   plan->nslots = fft_pool_slots(plan->pool);
+   return 0;
+}
+
+void fft_four_step_free(fft_plan *plan)
+{
+   fft_pool_destroy(plan->pool);
+   fft_plan_destroy(plan->row1);
+   fft_plan_destroy(plan->row2);
+   free(plan->tw_lo);
+   free(plan->tw_hi);
+}
+
+static int row_work_size(const fft_plan *plan)
+{
+   int w1 = fft_work_size(plan->row1);
+   int w2 = fft_work_size(plan->row2);
+   return w1 > w2 ? w1 : w2;
+}
+
+int fft_four_step_work_size(const fft_plan *plan)
+{
+   return plan->n + plan->nslots * row_work_size(plan);
+}
+
+/* dst (cols x rows) = transpose of rows [r0, r1) of src (rows x cols). */
+static void transpose(const struct Complex *src, struct Complex *dst,
+                      int rows, int cols, int r0, int r1)
+{
+   int i, j, ii, jj, iend, jend;
+
+   for (ii = r0; ii < r1; ii += TILE)
+   {
+      iend = ii + TILE < r1 ? ii + TILE : r1;
+      for (jj = 0; jj < cols; jj += TILE)
+      {
+         jend = jj + TILE < cols ? jj + TILE : cols;
+         for (j = jj; j < jend; j++)
+            for (i = ii; i < iend; i++)
+               dst[(size_t)j * rows + i] = src[(size_t)i * cols + j];
+      }
+   }
+}
+
+/* W^m for 0 <= m < n, from the two half tables. */
+static struct Complex twiddle(const fft_plan *plan, size_t m)
+{
+   struct Complex lo = plan->tw_lo[m & ((1 << plan->lo_bits) - 1)];
+   struct Complex hi = plan->tw_hi[m >> plan->lo_bits];
+   struct Complex w;
+
+   w.a = lo.a * hi.a - lo.b * hi.b;
+   w.b = lo.a * hi.b + lo.b * hi.a;
+   return w;
+}
+
+/* Rows of the source matrix each stage works through. */
+static int stage_rows(const fft_plan *plan, int stage)
+{
+   return (stage == STAGE_TRANSPOSE_12 || stage == STAGE_ROWS_2) ?
+          plan->n1 : plan->n2;
+}
+
+/* Number of tasks each stage is cut into: a few per thread so that a slow
+   thread does not hold up the rest, in whole tiles for the transposes. */
+static int stage_tasks(const fft_plan *plan, int stage)
+{
+   int units = stage_rows(plan, stage);
+   int tasks = plan->nslots * 4;
+
+   if (stage == STAGE_TRANSPOSE_12 || stage == STAGE_TRANSPOSE_21)
+      units = (units + TILE - 1) / TILE;
+   return tasks < units ? tasks : units;
+}
+
+static void four_step_task(void *arg, int task, int slot)
+{
+   const struct four_step_job *job = arg;
+   const fft_plan *plan = job->plan;
+   int rows = stage_rows(plan, job->stage);
+   int tasks = stage_tasks(plan, job->stage);
+   struct Complex *rw = job->work + (size_t)slot * row_work_size(plan);
+   struct Complex *row, w, t;
+   int tiles, r0, r1, r, k;
+
+   if (job->stage == STAGE_TRANSPOSE_12 || job->stage == STAGE_TRANSPOSE_21)
+   {
+      tiles = (rows + TILE - 1) / TILE;
+      r0 = (int)((long long)tiles * task / tasks) * TILE;
+      r1 = (int)((long long)tiles * (task + 1) / tasks) * TILE;
+      transpose(job->src, job->dst, rows, plan->n / rows, r0,
+                r1 < rows ? r1 : rows);
+      return;
+   }
+
+   r0 = (int)((long long)rows * task / tasks);
+   r1 = (int)((long long)rows * (task + 1) / tasks);
+   if (job->stage == STAGE_ROWS_2)
+   {
+      for (r = r0; r < r1; r++)
+      {
+         row = job->dst + (size_t)r * plan->n2;
+         fft_execute_work(plan->row2, row, row, rw);
+      }
+      return;
+   }
+
+   // Row r of the n2 x n1 matrix is column b = r of x.
+   for (r = r0; r < r1; r++)
+   {
+      row = job->dst + (size_t)r * plan->n1;
+      fft_execute_work(plan->row1, row, row, rw);
+      for (k = 1; k < plan->n1 && r > 0; k++)
+      {
+         w = twiddle(plan, (size_t)r * k);
+         t = row[k];
+         row[k].a = t.a * w.a - t.b * w.b;
+         row[k].b = t.a * w.b + t.b * w.a;
+      }
+   }
+}
+
+static void run_stage(struct four_step_job *job, int stage,
+                      const struct Complex *src, struct Complex *dst)
+{
+   job->stage = stage;
+   job->src = src;
+   job->dst = dst;
+   fft_pool_run(job->plan->pool, four_step_task, job,
+                stage_tasks(job->plan, stage));
+}
+
+void fft_four_step_execute(const fft_plan *plan, const struct Complex *in,
+                           struct Complex *out, struct Complex *work)
+{
+   struct four_step_job job;
+   struct Complex *buf = work;
+
+   job.plan = plan;
+   job.work = work + plan->n;
+
+   // Step 1 cannot transpose a non-square matrix in place, so an in-place
+   // call goes in -> buf -> out -> buf -> out with one extra copy.
+   if (in == out)
+   {
+      memcpy(buf, in, (size_t)plan->n * sizeof(*buf));
+      run_stage(&job, STAGE_TRANSPOSE_12, buf, out);
+      run_stage(&job, STAGE_ROWS_1, NULL, out);
+      run_stage(&job, STAGE_TRANSPOSE_21, out, buf);
+      run_stage(&job, STAGE_ROWS_2, NULL, buf);
+      run_stage(&job, STAGE_TRANSPOSE_12, buf, out);
+      return;
+   }
+   run_stage(&job, STAGE_TRANSPOSE_12, in, out);
+   run_stage(&job, STAGE_ROWS_1, NULL, out);
+   run_stage(&job, STAGE_TRANSPOSE_21, out, buf);
+   run_stage(&job, STAGE_ROWS_2, NULL, buf);
+   run_stage(&job, STAGE_TRANSPOSE_12, buf, out);
+}
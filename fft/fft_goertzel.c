@@ -0,0 +1,214 @@
+/*
+ * fft_goertzel.c
+ *
+ * A bank of Goertzel filters, for watching a few bins of a real signal
+ * without computing the whole spectrum.
+ *
+ * For bin k of an n-point frame, w = 2*pi*k/n, the recurrence
+ *
+ *    s[m] = x[m] + 2cos(w) s[m-1] - s[m-2],   s[-1] = s[-2] = 0
+ *
+ * costs one multiply and two adds per sample, and after the last sample
+ *
+ *    X[k] = (cos(w) s[n-1] - s[n-2]) + i sin(w) s[n-1]
+ *
+ * which is the same e^(-i*2*pi*k*m/n) sum as the FFT.  So b bins cost about
+ * 3bn flops against 2.5 n log2(n) for the real FFT.  Run as written, each
+ * sample waits for the multiply-add of the one before it, so every bin is
+ * split into PHASES filters on every PHASES-th sample (w becomes
+ * PHASES * w, which still lands on a whole turn after n / PHASES samples)
+ * that run side by side, and their results are turned back into place and
+ * summed.  That makes one bin about ten times cheaper than the whole
+ * spectrum at n = 1024.
+ *
+ * Past GOERTZEL_PER_LOG2N bins per log2(n) the FFT is cheaper, and with
+ * FFT_GOERTZEL_AUTO the bank switches to one real FFT of the frame and
+ * picks its bins out of that; the answer is the same either way.
+ * Rounding in the recurrence grows about like n for bins near 0 and n/2,
+ * which is still below 1e-12 of the peak at n = 4096.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "fft_internal.h"
+
+#define GOERTZEL_PER_LOG2N 0.6   // measured crossover, see fft_bench -g
+#define PHASES 8                 // independent filters per bin
+
+struct fft_goertzel
+{
+   int n, nbins;
+   int *bins;
+   int phases;                // PHASES, or 1 when n is not a multiple
+   double *c, *s;             // cos and sin of phases * w, for each bin
+   struct Complex *rot;       // e^(-i*w*p) for each bin and p < phases
+
+   // When the FFT is used instead
+   fft_real_plan *plan;       // NULL when filtering
+   struct Complex *X;         // n/2 + 1 bins
+   struct Complex *work;
+};
+
+
+fft_goertzel *fft_goertzel_create(int n, const int *bins, int nbins,
+                                  int method)
+{
+   fft_goertzel *g;
+   double w;
+   int i, p, m = 0;
+
+   if (n < 2 || n > FFT_MAX_SIZE || !bins || nbins < 1 ||
+       method < FFT_GOERTZEL_AUTO || method > FFT_GOERTZEL_FFT)
+      return NULL;
+   for (i = 0; i < nbins; i++)
+      if (bins[i] < 0 || bins[i] > n / 2)
+         return NULL;
+   while ((1 << m) < n)
+      m++;
+   if (method == FFT_GOERTZEL_AUTO)
+      method = nbins > GOERTZEL_PER_LOG2N * m ? FFT_GOERTZEL_FFT
+                                              : FFT_GOERTZEL_FILTER;
+   if (n % 2 != 0)
+      method = FFT_GOERTZEL_FILTER;   // the real FFT needs n even
+
+   g = calloc(1, sizeof(*g));
+   if (!g)
+      return NULL;
+   g->n = n;
+   g->nbins = nbins;
+   g->bins = malloc(nbins * sizeof(*g->bins));
+   if (!g->bins)
+   {
+      fft_goertzel_destroy(g);
+      return NULL;
+   }
+   for (i = 0; i < nbins; i++)
+      g->bins[i] = bins[i];
+
+   if (method == FFT_GOERTZEL_FFT)
+   {
+      g->plan = fft_real_plan_create(n, FFT_SIMD);
+      g->X = malloc((n / 2 + 1) * sizeof(*g->X));
+      if (g->plan)
+         g->work = malloc(fft_real_work_size(g->plan) * sizeof(*g->work));
+      if (!g->plan || !g->X || !g->work)
+      {
+         fft_goertzel_destroy(g);
+         return NULL;
+      }
+      return g;
+   }
+
+   g->phases = n % PHASES == 0 ? PHASES : 1;
+   g->c = malloc(nbins * sizeof(*g->c));
+   g->s = malloc(nbins * sizeof(*g->s));
+   g->rot = malloc(nbins * g->phases * sizeof(*g->rot));
+   if (!g->c || !g->s || !g->rot)
+   {
+      fft_goertzel_destroy(g);
+      return NULL;
+   }
+   for (i = 0; i < nbins; i++)
+   {
+      w = 2.0 * M_PI * bins[i] / n;
+      g->c[i] = cos(g->phases * w);
+      g->s[i] = sin(g->phases * w);
+      for (p = 0; p < g->phases; p++)
+      {
+         g->rot[i * g->phases + p].a = cos(w * p);
+         g->rot[i * g->phases + p].b = -sin(w * p);
+      }
+   }
+   return g;
+}
+
+void fft_goertzel_destroy(fft_goertzel *g)
+{
+   if (!g)
+      return;
+   fft_real_plan_destroy(g->plan);
+   free(g->X);
+   free(g->work);
+   free(g->bins);
+   free(g->c);
+   free(g->s);
+   free(g->rot);
+   free(g);
+}
+
+int fft_goertzel_uses_fft(const fft_goertzel *g)
+{
+   return g->plan != NULL;
+}
+
+/* One bin as PHASES interleaved filters: phase p runs on
+   x[p], x[p + PHASES], ... with w' = PHASES * w, so the chains do not
+   wait on each other, and its result is turned by e^(-i*w*p). */
+static struct Complex goertzel_phases(const double *x, int n, double c,
+                                      double s, const struct Complex *rot)
+{
+   double s1[PHASES] = { 0.0 }, s2[PHASES] = { 0.0 }, s0, ya, yb;
+   double k = 2.0 * c;
+   struct Complex X = { 0.0, 0.0 };
+   int m, p;
+
+   for (m = 0; m < n; m += PHASES)
+   {
+      #pragma GCC unroll 8
+      for (p = 0; p < PHASES; p++)
+      {
+         s0 = x[m + p] + k * s1[p] - s2[p];
+         s2[p] = s1[p];
+         s1[p] = s0;
+      }
+   }
+   for (p = 0; p < PHASES; p++)
+   {
+      ya = c * s1[p] - s2[p];
+      yb = s * s1[p];
+      X.a += ya * rot[p].a - yb * rot[p].b;
+      X.b += ya * rot[p].b + yb * rot[p].a;
+   }
+   return X;
+}
+
+/* The plain recurrence, for n that PHASES does not divide. */
+static struct Complex goertzel_single(const double *x, int n, double c,
+                                      double s)
+{
+   double s1 = 0.0, s2 = 0.0, s0, k = 2.0 * c;
+   struct Complex X;
+   int m;
+
+   for (m = 0; m < n; m++)
+   {
+      s0 = x[m] + k * s1 - s2;
+      s2 = s1;
+      s1 = s0;
+   }
+   X.a = c * s1 - s2;
+   X.b = s * s1;
+   return X;
+}
+
+void fft_goertzel_process(fft_goertzel *g, const double *x,
+                          struct Complex *out)
+{
+   int i;
+
+   if (g->plan)
+   {
+      fft_execute_r2c_work(g->plan, x, g->X, g->work);
+      for (i = 0; i < g->nbins; i++)
+         out[i] = g->X[g->bins[i]];
+      return;
+   }
+   for (i = 0; i < g->nbins; i++)
+   {
+      if (g->phases == PHASES)
+         out[i] = goertzel_phases(x, g->n, g->c[i], g->s[i],
+                                  g->rot + i * PHASES);
+      else
+         out[i] = goertzel_single(x, g->n, g->c[i], g->s[i]);
+   }
+}
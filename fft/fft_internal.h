@@ -0,0 +1,165 @@
+/*
+ * fft_internal.h
+ *
+ * Plan layout and helpers shared by the fft*.c files.  Callers only ever
+ * see the opaque fft_plan from fft.h.
+ */
+#ifndef FFT_INTERNAL_H
+#define FFT_INTERNAL_H
+
+#include "fft.h"
+
+typedef struct fft_pool fft_pool;
+
+#define FFT_MAX_FACTORS 32   // passes in a mixed-radix plan, >= log2 of FFT_MAX_SIZE
+
+struct fft_plan
+{
+   int n;                     // number of points
+   int m;                     // log2(n), rounded up if n is not 2^m
+   int kernel;                // FFT_RADIX2, FFT_STOCKHAM, ...
+   struct Complex *twiddle;   // twiddle[k] = e^(-i*2*pi*k/n), k < 3n/4
+   int *swaps;                // bit-reversal swap pairs, 2 ints per pair
+   int nswaps;                // number of pairs in swaps
+   int inverse;               // FFT_INVERSE was given
+
+   // FFT_SIMD only
+   int isa;                   // FFT_ISA_SSE2, _AVX2, _AVX512, or 0 for plain C
+   double *simd_twr;          // per-pass twiddles, split real/imaginary
+   double *simd_twi;
+   int *rev;                  // rev[i] = bitrev(i)
+
+   // FFT_FOUR_STEP only, see fft_fourstep.c
+   int n1, n2;                // n = n1 * n2, n1 >= n2
+   fft_plan *row1;            // FFT_SIMD plans for the n1- and n2-point rows
+   fft_plan *row2;
+   struct Complex *tw_lo;     // e^(-i*2*pi*k/n) (+i inverse), k < 2^lo_bits
+   struct Complex *tw_hi;     // the same for k = j * 2^lo_bits
+   int lo_bits;
+   fft_pool *pool;            // NULL when single-threaded
+   int nslots;                // row scratch buffers in the work area
+
+   // FFT_MIXED_RADIX and FFT_BLUESTEIN only, see fft_mixed.c
+   int factors[FFT_MAX_FACTORS];   // radix of each pass, in order
+   int nfactors;
+   struct Complex *wn;        // e^(-i*2*pi*k/n), k < n
+   struct Complex *chirp;     // e^(-i*pi*k^2/n), k < n
+   struct Complex *chirp_fft; // FFT of conj(chirp) / conv_m, wrapped
+   fft_plan *conv_fwd;        // conv_m-point plans for the convolution
+   fft_plan *conv_inv;
+   int conv_m;
+};
+
+/* fft.c */
+
+/* Fills twr/twi with the twiddles fft_simd_dif() expects for an n-point
+   transform (n >= 16) and returns how many entries that took, always
+   less than n. */
+int fft_simd_twiddles(double *twr, double *twi, int n);
+
+/* rev[i] = i with its log2(n) low bits reversed. */
+void fft_bit_reverse_table(int *rev, int n);
+
+/* Turns a table of output positions for the forward transform into one
+   for the inverse: bin k of the forward result is bin n - k (mod n) of the
+   inverse one, so a kernel that writes out[rev[i]] gets the inverse for
+   free. */
+void fft_inverse_table(int *rev, int n);
+
+/* fft_simd.c */
+
+/* Widest instruction set the CPU we are running on supports, as one of
+   the FFT_ISA_* values, or 0 if there is none (fft_simd_dif() then runs
+   plain C). */
+int fft_simd_best_isa(void);
+
+/* Runs the DIF passes with LE = n, n/2, ... down to 16 on split
+   real/imaginary data, two at a time as radix-4 with one radix-2 pass
+   first if there is an odd number of them.  With W = e^(-i*2*pi/LE),
+   twr/twi hold W^j (j < LE/2) for the radix-2 pass, then W^j, W^2j and W^3j
+   (j < LE/4 each) for every radix-4 pass.  The last three passes are left
+   to the caller. */
+void fft_simd_dif(int isa, double *re, double *im, int n,
+                  const double *twr, const double *twi);
+
+/* re[i] = in[i].a and im[i] = in[i].b for i < n, vectorised. */
+void fft_simd_split(int isa, const struct Complex *in, double *re,
+                    double *im, int n);
+
+/* The three passes fft_simd_dif() leaves over, on the n/8 blocks of 8
+   points, with the results written to out[rev[i]].  Vectorised across
+   blocks; n must be a multiple of 8. */
+void fft_simd_dif8(int isa, const double *re, const double *im, int n,
+                   struct Complex *out, const int *rev);
+
+/* The FFT_CODELET kernel for n = CODELET_MIN, 2 * CODELET_MIN, ...
+   CODELET_MAX (fft_codelets.h); work holds 2n doubles.  in may be out. */
+#define CODELET_MIN 64
+#define CODELET_MAX 4096
+void fft_simd_codelet(int isa, int n, int inverse, const struct Complex *in,
+                      struct Complex *out, double *work);
+
+/* Same passes in single precision, for fft_float.c. */
+void fft_simd_dif_float(int isa, float *re, float *im, int n,
+                        const float *twr, const float *twi);
+
+/* fft_fourstep.c */
+
+/* Fills in the FFT_FOUR_STEP fields of a plan whose n and m are set;
+   returns -1 when out of memory, leaving the rest to
+   fft_four_step_free(). */
+int fft_four_step_init(fft_plan *plan, int flags, int nthreads);
+void fft_four_step_free(fft_plan *plan);
+int fft_four_step_work_size(const fft_plan *plan);
+void fft_four_step_execute(const fft_plan *plan, const struct Complex *in,
+                           struct Complex *out, struct Complex *work);
+
+/* fft_mixed.c */
+
+/* Sets up a plan of any length as FFT_MIXED_RADIX or, if that cannot do n
+   or plan->kernel asks for it, FFT_BLUESTEIN.  Returns -1 when out of
+   memory, leaving the rest to fft_mixed_free(). */
+int fft_mixed_init(fft_plan *plan);
+void fft_mixed_free(fft_plan *plan);
+int fft_mixed_work_size(const fft_plan *plan);
+void fft_mixed_execute(const fft_plan *plan, const struct Complex *in,
+                       struct Complex *out, struct Complex *work);
+
+/* fft_wisdom.c */
+
+/* Kernel and ISA flags (plus FFT_INVERSE from flags) for an FFT_MEASURE
+   plan of n points, n a power of two, from the wisdom or by timing the
+   candidates now.  *nthreads is the caller's thread limit on the way in
+   and the number of threads to use on the way out.  Returns -1 when out
+   of memory. */
+int fft_wisdom_flags(int n, int flags, int *nthreads);
+
+/* fft_real.c */
+
+/* fft_execute_r2c_work() from the packing on: z holds the n samples as n/2
+   complex pairs, z[k] = x[2k] + i x[2k+1], and is overwritten.  work
+   needs fft_real_work_size() - n/2 elements. */
+void fft_r2c_packed_work(const fft_real_plan *plan, struct Complex *z,
+                         struct Complex *out, struct Complex *work);
+
+/* fft_thread.c */
+
+int fft_num_cpus(void);
+
+/* Starts a pool that runs jobs on nthreads threads in all, the caller
+   included (0 means one per CPU).  Returns NULL when out of memory. */
+fft_pool *fft_pool_create(int nthreads);
+void fft_pool_destroy(fft_pool *pool);
+
+/* Number of distinct slot values fn can be called with. */
+int fft_pool_slots(const fft_pool *pool);
+
+/* Calls fn(arg, task, slot) for task = 0..count-1 spread over the pool and
+   returns when all are done.  slot identifies the thread (0..slots-1) so
+   that fn can use per-thread scratch.  pool may be NULL, in which case
+   everything runs on the caller in slot 0.  Only one job may run on a
+   pool at a time. */
+void fft_pool_run(fft_pool *pool, void (*fn)(void *arg, int task, int slot),
+                  void *arg, int count);
+
+#endif
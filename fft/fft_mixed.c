@@ -0,0 +1,354 @@
+/*
+ * fft_mixed.c
+ *
+ * Lengths that are not powers of two.
+ *
+ * FFT_MIXED_RADIX handles n = 2^a 3^b 5^c 7^d with a Stockham autosort
+ * FFT, one pass per factor (radix 4 while it can, then 2, 3, 5, 7).  With
+ * L = the current sub-length, s = n / L the number of interleaved
+ * sub-transforms and m = L / p, a radix-p pass computes
+ *
+ *    y[q + s*(p*j + r)] = W_L^(j*r) * sum over t < p of
+ *                         x[q + s*(j + m*t)] * W_p^(t*r)
+ *
+ * for j < m, q < s and r < p, then carries on with L = m and s = s*p.  The
+ * output comes out in natural order, ping-ponging between out and the
+ * work buffer.  W_L^(j*r) is W_n^(j*r*s), so one table of n twiddles
+ * serves every pass.  The odd radices share one butterfly that pairs
+ * outputs r and p - r, since they differ only in the sign of the sine
+ * terms.
+ *
+ * FFT_BLUESTEIN handles any n up to FFT_MAX_SIZE / 2, and is what a
+ * length with a prime factor above 7 gets.  With c[j] = e^(-i*pi*j^2/n), jk = (j^2 + k^2 - (k-j)^2)/2
+ * turns the DFT into
+ *
+ *    X[k] = c[k] * sum over j of (x[j] c[j]) conj(c[k-j])
+ *
+ * a convolution, done circularly with power-of-two FFTs of M >= 2n - 1
+ * points.  The transform of conj(c), with the 1/M of the inverse folded
+ * in, is made with the plan.  It costs about three M-point FFTs, so 6 to
+ * 12 times an n-point one.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft_internal.h"
+
+/* Breaks n into the radices above, powers of 4 first.  Returns the number
+   of factors, or -1 if n has a prime factor above 7. */
+static int factorize(int n, int *factors)
+{
+   static const int radices[] = { 4, 2, 3, 5, 7 };
+   int count = 0, i;
+
+   for (i = 0; i < 5; i++)
+      while (n % radices[i] == 0)
+      {
+         factors[count++] = radices[i];
+         n /= radices[i];
+      }
+   return n == 1 ? count : -1;
+}
+
+static int init_mixed(fft_plan *plan)
+{
+   int n = plan->n, k;
+
+   plan->nfactors = factorize(n, plan->factors);
+   plan->wn = malloc(n * sizeof(*plan->wn));
+   if (!plan->wn)
+      return -1;
+   for (k = 0; k < n; k++)
+   {
+      plan->wn[k].a = cos(2.0 * M_PI * k / n);
+      plan->wn[k].b = -sin(2.0 * M_PI * k / n);
+   }
+   return 0;
+}
+
+static int init_bluestein(fft_plan *plan)
+{
+   int n = plan->n, M = 1, j;
+   long long jj;
+   struct Complex *b;
+   double a;
+
+   if (n > FFT_MAX_SIZE / 2)
+      return -1;
+   while (M < 2 * n - 1)
+      M *= 2;
+   plan->conv_m = M;
+   plan->conv_fwd = fft_plan_create(M, FFT_SIMD);
+   plan->conv_inv = fft_plan_create(M, FFT_SIMD | FFT_INVERSE);
+   plan->chirp = malloc(n * sizeof(*plan->chirp));
+   plan->chirp_fft = malloc(M * sizeof(*plan->chirp_fft));
+   if (!plan->conv_fwd || !plan->conv_inv || !plan->chirp || !plan->chirp_fft)
+      return -1;
+
+   for (j = 0; j < n; j++)
+   {
+      // j^2 mod 2n keeps the angle small, and so accurate, for large j.
+      jj = (long long)j * j % (2LL * n);
+      a = M_PI * jj / n;
+      plan->chirp[j].a = cos(a);
+      plan->chirp[j].b = -sin(a);
+   }
+
+   b = plan->chirp_fft;
+   memset(b, 0, M * sizeof(*b));
+   for (j = 0; j < n; j++)
+   {
+      b[j].a = plan->chirp[j].a / M;
+      b[j].b = -plan->chirp[j].b / M;
+      if (j > 0)
+         b[M - j] = b[j];
+   }
+   return fft_execute(plan->conv_fwd, b, b);
+}
+
+int fft_mixed_init(fft_plan *plan)
+{
+   int factors[FFT_MAX_FACTORS];
+
+   if (plan->kernel != FFT_BLUESTEIN && factorize(plan->n, factors) >= 0)
+   {
+      plan->kernel = FFT_MIXED_RADIX;
+      return init_mixed(plan);
+   }
+   plan->kernel = FFT_BLUESTEIN;
+   return init_bluestein(plan);
+}
+
+void fft_mixed_free(fft_plan *plan)
+{
+   free(plan->wn);
+   free(plan->chirp);
+   free(plan->chirp_fft);
+   fft_plan_destroy(plan->conv_fwd);
+   fft_plan_destroy(plan->conv_inv);
+}
+
+int fft_mixed_work_size(const fft_plan *plan)
+{
+   if (plan->kernel == FFT_BLUESTEIN)
+      return plan->conv_m + fft_work_size(plan->conv_fwd);
+   return plan->n;
+}
+
+
+/* (x.a + i x.b) * (w.a + i w.b) */
+static inline struct Complex cmul(struct Complex x, struct Complex w)
+{
+   struct Complex y;
+
+   y.a = x.a * w.a - x.b * w.b;
+   y.b = x.a * w.b + x.b * w.a;
+   return y;
+}
+
+static void pass2(const struct Complex *x, struct Complex *y, int m, int s,
+                  const struct Complex *w)
+{
+   struct Complex a0, a1, d;
+   int j, q;
+
+   for (j = 0; j < m; j++)
+      for (q = 0; q < s; q++)
+      {
+         a0 = x[q + s * j];
+         a1 = x[q + s * (j + m)];
+         y[q + s * 2 * j].a = a0.a + a1.a;
+         y[q + s * 2 * j].b = a0.b + a1.b;
+         d.a = a0.a - a1.a;
+         d.b = a0.b - a1.b;
+         y[q + s * (2 * j + 1)] = cmul(d, w[j * s]);
+      }
+}
+
+static void pass4(const struct Complex *x, struct Complex *y, int m, int s,
+                  const struct Complex *w)
+{
+   struct Complex a0, a1, a2, a3, t0, t1, t2, t3, b;
+   int j, q;
+
+   for (j = 0; j < m; j++)
+      for (q = 0; q < s; q++)
+      {
+         a0 = x[q + s * j];
+         a1 = x[q + s * (j + m)];
+         a2 = x[q + s * (j + 2 * m)];
+         a3 = x[q + s * (j + 3 * m)];
+         t0.a = a0.a + a2.a;  t0.b = a0.b + a2.b;
+         t1.a = a0.a - a2.a;  t1.b = a0.b - a2.b;
+         t2.a = a1.a + a3.a;  t2.b = a1.b + a3.b;
+         t3.a = a1.a - a3.a;  t3.b = a1.b - a3.b;
+
+         y[q + s * 4 * j].a = t0.a + t2.a;
+         y[q + s * 4 * j].b = t0.b + t2.b;
+         // X1 = t1 - i*t3, X2 = t0 - t2, X3 = t1 + i*t3
+         b.a = t1.a + t3.b;
+         b.b = t1.b - t3.a;
+         y[q + s * (4 * j + 1)] = cmul(b, w[j * s]);
+         b.a = t0.a - t2.a;
+         b.b = t0.b - t2.b;
+         y[q + s * (4 * j + 2)] = cmul(b, w[2 * j * s]);
+         b.a = t1.a - t3.b;
+         b.b = t1.b + t3.a;
+         y[q + s * (4 * j + 3)] = cmul(b, w[3 * j * s]);
+      }
+}
+
+/* Radix p for odd p <= 7.  With u_t = a_t + a_(p-t) and v_t = a_t - a_(p-t),
+   output r is a_0 + sum cos(2 pi t r / p) u_t - i sum sin(2 pi t r / p) v_t,
+   and p - r the same with +i.  Always inlined into pass3/5/7 below so
+   that p is a constant and the inner loops unroll. */
+static inline __attribute__((always_inline))
+void pass_odd(const struct Complex *x, struct Complex *y, int m, int s,
+              int p, const struct Complex *w)
+{
+   double c[4][4], sn[4][4];
+   struct Complex a[7], u[4], v[4], re, im, b;
+   int h = p / 2, j, q, t, r;
+
+   for (r = 1; r <= h; r++)
+      for (t = 1; t <= h; t++)
+      {
+         c[r][t] = cos(2.0 * M_PI * t * r / p);
+         sn[r][t] = sin(2.0 * M_PI * t * r / p);
+      }
+
+   for (j = 0; j < m; j++)
+      for (q = 0; q < s; q++)
+      {
+         for (t = 0; t < p; t++)
+            a[t] = x[q + s * (j + m * t)];
+         b = a[0];
+         for (t = 1; t <= h; t++)
+         {
+            u[t].a = a[t].a + a[p - t].a;
+            u[t].b = a[t].b + a[p - t].b;
+            v[t].a = a[t].a - a[p - t].a;
+            v[t].b = a[t].b - a[p - t].b;
+            b.a += u[t].a;
+            b.b += u[t].b;
+         }
+         y[q + s * p * j] = b;
+
+         for (r = 1; r <= h; r++)
+         {
+            re = a[0];
+            im.a = im.b = 0.0;
+            for (t = 1; t <= h; t++)
+            {
+               re.a += c[r][t] * u[t].a;
+               re.b += c[r][t] * u[t].b;
+               im.a += sn[r][t] * v[t].a;
+               im.b += sn[r][t] * v[t].b;
+            }
+            // re - i*im and re + i*im
+            b.a = re.a + im.b;
+            b.b = re.b - im.a;
+            y[q + s * (p * j + r)] = cmul(b, w[j * r * s]);
+            b.a = re.a - im.b;
+            b.b = re.b + im.a;
+            y[q + s * (p * j + p - r)] = cmul(b, w[j * (p - r) * s]);
+         }
+      }
+}
+
+static void pass3(const struct Complex *x, struct Complex *y, int m, int s,
+                  const struct Complex *w)
+{
+   pass_odd(x, y, m, s, 3, w);
+}
+
+static void pass5(const struct Complex *x, struct Complex *y, int m, int s,
+                  const struct Complex *w)
+{
+   pass_odd(x, y, m, s, 5, w);
+}
+
+static void pass7(const struct Complex *x, struct Complex *y, int m, int s,
+                  const struct Complex *w)
+{
+   pass_odd(x, y, m, s, 7, w);
+}
+
+static void mixed_radix(const fft_plan *plan, const struct Complex *in,
+                        struct Complex *out, struct Complex *work)
+{
+   const struct Complex *src = in;
+   struct Complex *dst;
+   int L = plan->n, s = 1, i, p;
+
+   if (plan->nfactors == 0)
+   {
+      if (in != out)
+         out[0] = in[0];
+      return;
+   }
+   // Pick the first destination so that the last pass lands in out.  An
+   // odd pass count starts in out, which in place means copying in away
+   // first.
+   dst = plan->nfactors % 2 ? out : work;
+   if (plan->nfactors % 2 && in == out)
+   {
+      memcpy(work, in, plan->n * sizeof(*work));
+      src = work;
+   }
+
+   for (i = 0; i < plan->nfactors; i++)
+   {
+      p = plan->factors[i];
+      switch (p)
+      {
+      case 2:
+         pass2(src, dst, L / 2, s, plan->wn);
+         break;
+      case 4:
+         pass4(src, dst, L / 4, s, plan->wn);
+         break;
+      case 3:
+         pass3(src, dst, L / 3, s, plan->wn);
+         break;
+      case 5:
+         pass5(src, dst, L / 5, s, plan->wn);
+         break;
+      default:
+         pass7(src, dst, L / 7, s, plan->wn);
+         break;
+      }
+      L /= p;
+      s *= p;
+      src = dst;
+      dst = dst == out ? work : out;
+   }
+}
+
+static void bluestein(const fft_plan *plan, const struct Complex *in,
+                      struct Complex *out, struct Complex *work)
+{
+   const struct Complex *c = plan->chirp, *B = plan->chirp_fft;
+   struct Complex *a = work, *sub = work + plan->conv_m;
+   int n = plan->n, M = plan->conv_m, k;
+
+   for (k = 0; k < n; k++)
+      a[k] = cmul(in[k], c[k]);
+   memset(a + n, 0, (M - n) * sizeof(*a));
+   fft_execute_work(plan->conv_fwd, a, a, sub);
+   for (k = 0; k < M; k++)
+      a[k] = cmul(a[k], B[k]);
+   fft_execute_work(plan->conv_inv, a, a, sub);
+   for (k = 0; k < n; k++)
+      out[k] = cmul(a[k], c[k]);
+}
+
+void fft_mixed_execute(const fft_plan *plan, const struct Complex *in,
+                       struct Complex *out, struct Complex *work)
+{
+   if (plan->kernel == FFT_BLUESTEIN)
+      bluestein(plan, in, out, work);
+   else
+      mixed_radix(plan, in, out, work);
+}
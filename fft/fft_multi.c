@@ -0,0 +1,146 @@
+/*
+ * fft_multi.c
+ *
+ * Real transforms of every channel of an interleaved multi-channel block.
+ *
+ * The real transform of fft_real.c starts by packing the samples in pairs,
+ * z[k] = x[2k] + i x[2k+1], which in memory is just the samples in order.
+ * So de-interleaving the block straight into one packed buffer per channel
+ * is the packing step too: one pass over the block does both, after which
+ * the channels are independent and are shared out over a thread pool, one
+ * task per channel, each going from the half-length FFT to the magnitudes.
+ *
+ * The pass is a transpose of n rows by channels columns, done BLOCK rows
+ * at a time so that each channel's buffer is written a whole cache line at
+ * once while the rows being read stay in L1.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "fft_internal.h"
+
+#define BLOCK 8   // rows per step of the transpose, 64 bytes a channel
+
+struct fft_multi_plan
+{
+   int n, channels;
+   fft_real_plan *real;
+   struct Complex *z;         // channel c packed at z + c * n/2
+   fft_pool *pool;            // NULL when single-threaded
+   int nslots;
+   struct Complex **work;     // one per pool slot
+};
+
+/* What the pool tasks need to see. */
+struct multi_job
+{
+   const fft_multi_plan *plan;
+   struct Complex *out;
+   float *mag;
+};
+
+
+/* out[c*n + t] = in[t*channels + c]. */
+static void deinterleave(const double *in, double *out, int n, int channels)
+{
+   int t0, t, c, rows;
+
+   for (t0 = 0; t0 < n; t0 += BLOCK)
+   {
+      rows = n - t0 < BLOCK ? n - t0 : BLOCK;
+      for (c = 0; c < channels; c++)
+         for (t = t0; t < t0 + rows; t++)
+            out[(size_t)c * n + t] = in[(size_t)t * channels + c];
+   }
+}
+
+static void multi_task(void *arg, int task, int slot)
+{
+   const struct multi_job *job = arg;
+   const fft_multi_plan *p = job->plan;
+   const int h = p->n / 2;
+   struct Complex *X = job->out + (size_t)task * (h + 1);
+   float *mag;
+   int k;
+
+   fft_r2c_packed_work(p->real, p->z + (size_t)task * h, X, p->work[slot]);
+   if (!job->mag)
+      return;
+   mag = job->mag + (size_t)task * (h + 1);
+   for (k = 0; k <= h; k++)
+      mag[k] = hypot(X[k].a, X[k].b) / p->n;
+}
+
+fft_multi_plan *fft_multi_plan_create(int n, int channels, int flags,
+                                      int nthreads)
+{
+   fft_multi_plan *p;
+   int i;
+
+   if (channels < 1)
+      return NULL;
+   p = calloc(1, sizeof(*p));
+   if (!p)
+      return NULL;
+   p->n = n;
+   p->channels = channels;
+   p->real = fft_real_plan_create(n, flags);
+   if (!p->real)
+   {
+      fft_multi_plan_destroy(p);
+      return NULL;
+   }
+   p->z = malloc((size_t)channels * (n / 2) * sizeof(*p->z));
+   if (nthreads != 1 && channels > 1)
+      p->pool = fft_pool_create(nthreads);
+   p->nslots = fft_pool_slots(p->pool);
+   p->work = calloc(p->nslots, sizeof(*p->work));
+   if (!p->z || !p->work)
+   {
+      fft_multi_plan_destroy(p);
+      return NULL;
+   }
+   for (i = 0; i < p->nslots; i++)
+   {
+      p->work[i] = malloc(fft_real_work_size(p->real) * sizeof(**p->work));
+      if (!p->work[i])
+      {
+         fft_multi_plan_destroy(p);
+         return NULL;
+      }
+   }
+   return p;
+}
+
+void fft_multi_plan_destroy(fft_multi_plan *p)
+{
+   int i;
+
+   if (!p)
+      return;
+   fft_pool_destroy(p->pool);
+   if (p->work)
+      for (i = 0; i < p->nslots; i++)
+         free(p->work[i]);
+   free(p->work);
+   free(p->z);
+   fft_real_plan_destroy(p->real);
+   free(p);
+}
+
+int fft_multi_channels(const fft_multi_plan *p)
+{
+   return p->channels;
+}
+
+void fft_multi_execute(fft_multi_plan *p, const double *in,
+                       struct Complex *out, float *mag)
+{
+   struct multi_job job;
+
+   deinterleave(in, (double *)p->z, p->n, p->channels);
+   job.plan = p;
+   job.out = out;
+   job.mag = mag;
+   fft_pool_run(p->pool, multi_task, &job, p->channels);
+}
@@ -0,0 +1,187 @@
+/*
+ * fft_real.c
+ *
+ * Real-input transforms built on a half-length complex FFT.
+ *
+ * For n real samples x, the even and odd samples are packed into one
+ * complex sequence z[k] = x[2k] + i*x[2k+1] of h = n/2 points.  After
+ * Z = FFT(z), the even and odd spectra are pulled apart again with
+ *
+ *    E[k] = (Z[k] + conj(Z[h-k])) / 2
+ *    O[k] = (Z[k] - conj(Z[h-k])) / 2i
+ *    X[k] = E[k] + W^k O[k],   W = e^(-i*2*pi/n),   k = 0..h
+ *
+ * which gives the h+1 non-redundant bins (the rest are conj(X[n-k])).  The
+ * inverse runs the same steps backwards.  Both directions cost one h-point
+ * complex FFT plus an O(n) pass, about half of an n-point complex FFT.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "fft_internal.h"
+
+struct fft_real_plan
+{
+   int n;                  // number of real samples
+   fft_plan *half;         // n/2-point complex plan
+   struct Complex *w;      // w[k] = e^(-i*2*pi*k/n), k <= n/2
+};
+
+
+fft_real_plan *fft_real_plan_create(int n, int flags)
+{
+   fft_real_plan *plan;
+   int k;
+
+   if (n < 2 || n > FFT_MAX_SIZE || n % 2 != 0)
+      return NULL;
+   plan = calloc(1, sizeof(*plan));
+   if (!plan)
+      return NULL;
+   plan->n = n;
+   plan->half = fft_plan_create(n / 2, flags & ~FFT_INVERSE);
+   plan->w = malloc((n / 2 + 1) * sizeof(*plan->w));
+   if (!plan->half || !plan->w)
+   {
+      fft_real_plan_destroy(plan);
+      return NULL;
+   }
+   for (k = 0; k <= n / 2; k++)
+   {
+      plan->w[k].a = cos(2.0 * M_PI * k / n);
+      plan->w[k].b = -sin(2.0 * M_PI * k / n);
+   }
+   return plan;
+}
+
+void fft_real_plan_destroy(fft_real_plan *plan)
+{
+   if (!plan)
+      return;
+   fft_plan_destroy(plan->half);
+   free(plan->w);
+   free(plan);
+}
+
+int fft_real_work_size(const fft_real_plan *plan)
+{
+   return plan->n / 2 + fft_work_size(plan->half);
+}
+
+void fft_execute_r2c_work(const fft_real_plan *plan, const double *in,
+                          struct Complex *out, struct Complex *work)
+{
+   fft_execute_r2c_window_work(plan, in, NULL, out, work);
+}
+
+void fft_execute_r2c_window_work(const fft_real_plan *plan, const double *in,
+                                 const double *window, struct Complex *out,
+                                 struct Complex *work)
+{
+   int h = plan->n / 2, k;
+
+   if (window)
+      for (k = 0; k < h; k++)
+      {
+         work[k].a = in[2 * k] * window[2 * k];
+         work[k].b = in[2 * k + 1] * window[2 * k + 1];
+      }
+   else
+      for (k = 0; k < h; k++)
+      {
+         work[k].a = in[2 * k];
+         work[k].b = in[2 * k + 1];
+      }
+   fft_r2c_packed_work(plan, work, out, work + h);
+}
+
+void fft_r2c_packed_work(const fft_real_plan *plan, struct Complex *z,
+                         struct Complex *out, struct Complex *work)
+{
+   const struct Complex *w = plan->w;
+   int h = plan->n / 2;
+   struct Complex A, B, E, O, WO;
+   int k;
+
+   fft_execute_work(plan->half, z, z, work);
+
+   // k and h-k are done together, since each needs the other's Z.
+   for (k = 0; k <= h / 2; k++)
+   {
+      A = z[k];
+      B = z[(h - k) % h];
+
+      E.a = 0.5 * (A.a + B.a);
+      E.b = 0.5 * (A.b - B.b);
+      O.a = 0.5 * (A.b + B.b);
+      O.b = 0.5 * (B.a - A.a);
+      WO.a = w[k].a * O.a - w[k].b * O.b;
+      WO.b = w[k].a * O.b + w[k].b * O.a;
+      out[k].a = E.a + WO.a;
+      out[k].b = E.b + WO.b;
+
+      // E and O at h-k are conj(E) and conj(O), and W^(h-k) = -conj(W^k),
+      // so X[h-k] = conj(E - W^k O).
+      out[h - k].a = E.a - WO.a;
+      out[h - k].b = WO.b - E.b;
+   }
+}
+
+void fft_execute_c2r_work(const fft_real_plan *plan, const struct Complex *in,
+                          double *out, struct Complex *work)
+{
+   const struct Complex *w = plan->w;
+   int h = plan->n / 2;
+   struct Complex *z = work;
+   struct Complex A, B, E, D, O;
+   int k;
+
+   // Z[k] = E[k] + i*O[k], with E = X[k] + conj(X[h-k]) and
+   // O = (X[k] - conj(X[h-k])) conj(W^k).  The 1/2 of the forward
+   // direction is left out so that c2r(r2c(x)) = n*x.  Z is stored
+   // conjugated, so that the forward FFT below works as an inverse one.
+   for (k = 0; k < h; k++)
+   {
+      A = in[k];
+      B = in[h - k];
+      E.a = A.a + B.a;
+      E.b = A.b - B.b;
+      D.a = A.a - B.a;
+      D.b = A.b + B.b;
+      O.a = D.a * w[k].a + D.b * w[k].b;
+      O.b = D.b * w[k].a - D.a * w[k].b;
+      z[k].a = E.a - O.b;
+      z[k].b = -(E.b + O.a);
+   }
+   fft_execute_work(plan->half, z, z, work + h);
+
+   for (k = 0; k < h; k++)
+   {
+      out[2 * k] = z[k].a;
+      out[2 * k + 1] = -z[k].b;
+   }
+}
+
+int fft_execute_r2c(const fft_real_plan *plan, const double *in,
+                    struct Complex *out)
+{
+   struct Complex *work = malloc(fft_real_work_size(plan) * sizeof(*work));
+
+   if (!work)
+      return -1;
+   fft_execute_r2c_work(plan, in, out, work);
+   free(work);
+   return 0;
+}
+
+int fft_execute_c2r(const fft_real_plan *plan, const struct Complex *in,
+                    double *out)
+{
+   struct Complex *work = malloc(fft_real_work_size(plan) * sizeof(*work));
+
+   if (!work)
+      return -1;
+   fft_execute_c2r_work(plan, in, out, work);
+   free(work);
+   return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * fft_sdft.c
+ *
+ * Sliding DFT: the spectrum of the last n samples of a stream, brought up
+ * to date on every sample.  When sample x[t] comes in and x[t-n] drops
+ * out of the window,
+ *
+ *    X_k(t) = (X_k(t-1) + x[t] - x[t-n]) e^(+i*2*pi*k/n)
+ *
+ * which is one complex multiply per bin per sample: O(n) for the whole
+ * spectrum, O(1) for each bin watched.  The result is the same
+ * e^(-i*2*pi*k*m/n) sum the FFT would give for the window, oldest sample
+ * at m = 0.
+ *
+ * The rotation is rounded, so its magnitude is not exactly 1 and the
+ * errors of every update are carried forward for good.  Left alone the
+ * bins drift by about 1e-16 of their size per update.  Every anchor
+ * samples the bins are therefore recomputed from the window itself with a
+ * Goertzel bank (fft_goertzel.c), which takes one real FFT when all the
+ * bins are wanted and O(n) per bin when only a few are.  With the default
+ * anchor of n samples that costs about log2(n) / 2 operations per sample
+ * on top of the updates.
+ *
+ * The window is kept twice over in a 2n ring, each sample written at i
+ * and i + n, so the last n samples are always contiguous for the
+ * recomputation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft_internal.h"
+
+#define LANES 4   // bins updated per step of the inner loop
+
+/* The bins X and their rotations e^(+i*2*pi*k/n) are kept in blocks of
+   LANES bins, each block holding Re X, Im X, Re rot and Im rot of its bins
+   in turn.  One block is one cache-line pair, and the four streams cannot
+   alias each other in the cache the way four separate arrays of the same
+   size can. */
+#define AT(s, i, part) (s)->state[((i) / LANES * 4 + (part)) * LANES + \
+                                   (i) % LANES]
+#define RE(s, i) AT(s, i, 0)
+#define IM(s, i) AT(s, i, 1)
+#define CR(s, i) AT(s, i, 2)
+#define CI(s, i) AT(s, i, 3)
+
+struct fft_sdft
+{
+   int n, nbins, anchor;
+   int padded;                // nbins rounded up to LANES
+   int *bins;
+   double *state;             // the bins and rotations, see below
+   double *hist;              // 2n ring, the window twice over
+   int pos;                   // oldest sample at hist[pos], pos < n
+   int since;                 // samples since the last recomputation
+   fft_goertzel *bank;        // recomputes the bins from the window
+   struct Complex *X;         // its output
+};
+
+
+fft_sdft *fft_sdft_create(int n, const int *bins, int nbins, int anchor)
+{
+   fft_sdft *s;
+   int i;
+
+   if (n < 2 || n > FFT_MAX_SIZE || anchor < 0)
+      return NULL;
+   if (!bins)
+      nbins = n / 2 + 1;
+   if (nbins < 1)
+      return NULL;
+   s = calloc(1, sizeof(*s));
+   if (!s)
+      return NULL;
+   s->n = n;
+   s->nbins = nbins;
+   s->anchor = anchor ? anchor : n;
+   s->padded = (nbins + LANES - 1) / LANES * LANES;
+   s->bins = malloc(nbins * sizeof(*s->bins));
+   s->state = calloc(4 * s->padded, sizeof(*s->state));
+   s->hist = malloc(2 * n * sizeof(*s->hist));
+   s->X = malloc(nbins * sizeof(*s->X));
+   if (!s->bins || !s->state || !s->hist || !s->X)
+   {
+      fft_sdft_destroy(s);
+      return NULL;
+   }
+   for (i = 0; i < nbins; i++)
+      s->bins[i] = bins ? bins[i] : i;
+   // Checks the bins too.
+   s->bank = fft_goertzel_create(n, s->bins, nbins, FFT_GOERTZEL_AUTO);
+   if (!s->bank)
+   {
+      fft_sdft_destroy(s);
+      return NULL;
+   }
+   for (i = 0; i < nbins; i++)
+   {
+      CR(s, i) = cos(2.0 * M_PI * s->bins[i] / n);
+      CI(s, i) = sin(2.0 * M_PI * s->bins[i] / n);
+   }
+   fft_sdft_reset(s);
+   return s;
+}
+
+void fft_sdft_destroy(fft_sdft *s)
+{
+   if (!s)
+      return;
+   fft_goertzel_destroy(s->bank);
+   free(s->bins);
+   free(s->state);
+   free(s->hist);
+   free(s->X);
+   free(s);
+}
+
+void fft_sdft_reset(fft_sdft *s)
+{
+   int i;
+
+   for (i = 0; i < s->padded; i++)
+      RE(s, i) = IM(s, i) = 0.0;
+   memset(s->hist, 0, 2 * s->n * sizeof(*s->hist));
+   s->pos = 0;
+   s->since = 0;
+}
+
+int fft_sdft_bins(const fft_sdft *s)
+{
+   return s->nbins;
+}
+
+/* Recomputes every bin from the window, dropping the drift. */
+static void reanchor(fft_sdft *s)
+{
+   int i;
+
+   fft_goertzel_process(s->bank, s->hist + s->pos, s->X);
+   for (i = 0; i < s->nbins; i++)
+   {
+      RE(s, i) = s->X[i].a;
+      IM(s, i) = s->X[i].b;
+   }
+}
+
+/* X = (X + d) rot for every bin, a block at a time.  Written LANES
+   bins wide so that the compiler turns it into vector code at -O2.  The
+   padding bins have a zero rotation and stay 0. */
+static void update(double *state, int padded, double d)
+{
+   double *re, *im, *cr, *ci, t;
+   int i, k;
+
+   for (i = 0; i < padded; i += LANES, state += 4 * LANES)
+   {
+      re = state;
+      im = re + LANES;
+      cr = im + LANES;
+      ci = cr + LANES;
+      for (k = 0; k < LANES; k++)
+      {
+         t = re[k] + d;
+         re[k] = t * cr[k] - im[k] * ci[k];
+         im[k] = t * ci[k] + im[k] * cr[k];
+      }
+   }
+}
+
+void fft_sdft_process(fft_sdft *s, const double *in, int count)
+{
+   double *hist = s->hist, d;
+   int n = s->n, pos = s->pos, since = s->since, j;
+
+   for (j = 0; j < count; j++)
+   {
+      d = in[j] - hist[pos];
+      hist[pos] = in[j];
+      hist[pos + n] = in[j];
+      if (++pos == n)
+         pos = 0;
+
+      if (++since >= s->anchor)
+      {
+         s->pos = pos;
+         reanchor(s);
+         since = 0;
+         continue;
+      }
+      update(s->state, s->padded, d);
+   }
+   s->pos = pos;
+   s->since = since;
+}
+
+void fft_sdft_spectrum(const fft_sdft *s, struct Complex *out)
+{
+   int i;
+
+   for (i = 0; i < s->nbins; i++)
+   {
+      out[i].a = RE(s, i);
+      out[i].b = IM(s, i);
+   }
+}
@@ -0,0 +1,439 @@
+/*
+ * fft_simd.c
+ *
+ * SSE2, AVX2 and AVX-512 versions of the butterfly passes used by the
+ * FFT_SIMD kernel and by the float engine (fft_float.c), of the
+ * FFT_CODELET kernels generated by gen_codelets.c, and the run-time
+ * check that picks between them.  Float vectors hold twice as many lanes
+ * as double ones at each width.
+ * All three are built from fft_simd_body.h; each is compiled for its own
+ * instruction set with a target attribute, so the rest of the program is
+ * still built for plain x86-64 and runs on any machine.
+ *
+ * A scalar build of the same body is always there as well; it is what
+ * FFT_SIMD runs on other architectures, where fft_simd_best_isa() returns 0.
+ */
+
+#include <math.h>
+#include "fft_internal.h"
+
+#define SIMD_FN       dif_scalar
+#define SIMD_DIF8     dif8_scalar
+#define SIMD_SPLIT    split_scalar
+#define SIMD_TARGET
+#define SIMD_REAL     double
+#define SIMD_VEC      double
+#define SIMD_W        1
+#define SIMD_LOAD(p)  (*(p))
+#define SIMD_STORE(p, v) (*(p) = (v))
+#define SIMD_ADD(a, b) ((a) + (b))
+#define SIMD_SUB(a, b) ((a) - (b))
+#define SIMD_MUL(a, b) ((a) * (b))
+#define SIMD_FMADD(a, b, c) ((a) * (b) + (c))
+#define SIMD_FMSUB(a, b, c) ((a) * (b) - (c))
+#define SIMD_SET1(x)  (x)
+#define SIMD_TRANSPOSE(v)
+#define SIMD_STORE_COMPLEX(z, re, im) ((z)[0].a = (re), (z)[0].b = (im))
+#define SIMD_LOAD_COMPLEX(z, re, im) ((re) = (z)[0].a, (im) = (z)[0].b)
+#define SIMD_CODELET(f) f##_scalar
+#define SIMD_STORE_NATURAL(z, re, im) ((z)[0].a = (re), (z)[0].b = (im))
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_scalar_f
+#define SIMD_TARGET
+#define SIMD_REAL     float
+#define SIMD_VEC      float
+#define SIMD_W        1
+#define SIMD_LOAD(p)  (*(p))
+#define SIMD_STORE(p, v) (*(p) = (v))
+#define SIMD_ADD(a, b) ((a) + (b))
+#define SIMD_SUB(a, b) ((a) - (b))
+#define SIMD_MUL(a, b) ((a) * (b))
+#define SIMD_FMADD(a, b, c) ((a) * (b) + (c))
+#define SIMD_FMSUB(a, b, c) ((a) * (b) - (c))
+#include "fft_simd_body.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/* In-register transposes for the double builds' codelets. */
+__attribute__((target("sse2")))
+static inline void transpose_sse2(__m128d *v)
+{
+   __m128d t = _mm_unpacklo_pd(v[0], v[1]);
+
+   v[1] = _mm_unpackhi_pd(v[0], v[1]);
+   v[0] = t;
+}
+
+__attribute__((target("avx2,fma")))
+static inline void transpose_avx2(__m256d *v)
+{
+   __m256d t0 = _mm256_unpacklo_pd(v[0], v[1]);   // v00 v10 v02 v12
+   __m256d t1 = _mm256_unpackhi_pd(v[0], v[1]);   // v01 v11 v03 v13
+   __m256d t2 = _mm256_unpacklo_pd(v[2], v[3]);
+   __m256d t3 = _mm256_unpackhi_pd(v[2], v[3]);
+
+   v[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+   v[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+   v[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+   v[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+/* Interleaved complex to separate real and imaginary vectors.  Macros, as
+   they set two results. */
+#define load_complex_sse2(z, re, im) \
+   do { \
+      __m128d a_ = _mm_loadu_pd(&(z)[0].a), b_ = _mm_loadu_pd(&(z)[1].a); \
+      (re) = _mm_unpacklo_pd(a_, b_); \
+      (im) = _mm_unpackhi_pd(a_, b_); \
+   } while (0)
+
+// [r0 i0 r1 i1] [r2 i2 r3 i3] -> [r0 i0 r2 i2] [r1 i1 r3 i3] -> unpack
+#define load_complex_avx2(z, re, im) \
+   do { \
+      __m256d a_ = _mm256_loadu_pd(&(z)[0].a); \
+      __m256d b_ = _mm256_loadu_pd(&(z)[2].a); \
+      __m256d c_ = _mm256_permute2f128_pd(a_, b_, 0x20); \
+      __m256d d_ = _mm256_permute2f128_pd(a_, b_, 0x31); \
+      (re) = _mm256_unpacklo_pd(c_, d_); \
+      (im) = _mm256_unpackhi_pd(c_, d_); \
+   } while (0)
+
+#define load_complex_avx512(z, re, im) \
+   do { \
+      __m512d a_ = _mm512_loadu_pd(&(z)[0].a); \
+      __m512d b_ = _mm512_loadu_pd(&(z)[4].a); \
+      (re) = _mm512_permutex2var_pd(a_, _mm512_set_epi64(14, 12, 10, 8, \
+                                    6, 4, 2, 0), b_); \
+      (im) = _mm512_permutex2var_pd(a_, _mm512_set_epi64(15, 13, 11, 9, \
+                                    7, 5, 3, 1), b_); \
+   } while (0)
+
+/* And back, in order, for the codelets. */
+#define store_natural_avx2(z, re, im) \
+   do { \
+      __m256d a_ = _mm256_unpacklo_pd(re, im);   /* r0 i0 r2 i2 */ \
+      __m256d b_ = _mm256_unpackhi_pd(re, im);   /* r1 i1 r3 i3 */ \
+      _mm256_storeu_pd(&(z)[0].a, _mm256_permute2f128_pd(a_, b_, 0x20)); \
+      _mm256_storeu_pd(&(z)[2].a, _mm256_permute2f128_pd(a_, b_, 0x31)); \
+   } while (0)
+
+#define store_natural_avx512(z, re, im) \
+   do { \
+      __m512d a_ = _mm512_unpacklo_pd(re, im); \
+      __m512d b_ = _mm512_unpackhi_pd(re, im); \
+      _mm512_storeu_pd(&(z)[0].a, _mm512_permutex2var_pd(a_, \
+                       _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), b_)); \
+      _mm512_storeu_pd(&(z)[4].a, _mm512_permutex2var_pd(a_, \
+                       _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), b_)); \
+   } while (0)
+
+__attribute__((target("avx512f")))
+static inline void transpose_avx512(__m512d *v)
+{
+   __m512d t[8], u[8];
+   int i;
+
+   // Pairs of rows interleaved, then 128-bit lanes gathered in two steps:
+   // 0x88 takes lanes 0 and 2 of each source, 0xdd lanes 1 and 3.
+   for (i = 0; i < 8; i += 2)
+   {
+      t[i] = _mm512_unpacklo_pd(v[i], v[i + 1]);
+      t[i + 1] = _mm512_unpackhi_pd(v[i], v[i + 1]);
+   }
+   for (i = 0; i < 8; i += 4)
+   {
+      u[i] = _mm512_shuffle_f64x2(t[i], t[i + 2], 0x88);
+      u[i + 1] = _mm512_shuffle_f64x2(t[i + 1], t[i + 3], 0x88);
+      u[i + 2] = _mm512_shuffle_f64x2(t[i], t[i + 2], 0xdd);
+      u[i + 3] = _mm512_shuffle_f64x2(t[i + 1], t[i + 3], 0xdd);
+   }
+   for (i = 0; i < 4; i++)
+   {
+      v[i] = _mm512_shuffle_f64x2(u[i], u[i + 4], 0x88);
+      v[i + 4] = _mm512_shuffle_f64x2(u[i], u[i + 4], 0xdd);
+   }
+}
+
+#define SIMD_FN       dif_sse2
+#define SIMD_DIF8     dif8_sse2
+#define SIMD_SPLIT    split_sse2
+#define SIMD_TARGET   __attribute__((target("sse2")))
+#define SIMD_REAL     double
+#define SIMD_VEC      __m128d
+#define SIMD_W        2
+#define SIMD_LOAD     _mm_loadu_pd
+#define SIMD_STORE    _mm_storeu_pd
+#define SIMD_ADD      _mm_add_pd
+#define SIMD_SUB      _mm_sub_pd
+#define SIMD_MUL      _mm_mul_pd
+#define SIMD_FMADD(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+#define SIMD_FMSUB(a, b, c) _mm_sub_pd(_mm_mul_pd(a, b), c)
+#define SIMD_SET1     _mm_set1_pd
+#define SIMD_TRANSPOSE transpose_sse2
+#define SIMD_STORE_COMPLEX(z, re, im) \
+   (_mm_storeu_pd(&(z)[0].a, _mm_unpacklo_pd(re, im)), \
+    _mm_storeu_pd(&(z)[1].a, _mm_unpackhi_pd(re, im)))
+#define SIMD_LOAD_COMPLEX  load_complex_sse2
+#define SIMD_CODELET(f) f##_sse2
+#define SIMD_STORE_NATURAL SIMD_STORE_COMPLEX
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_avx2
+#define SIMD_DIF8     dif8_avx2
+#define SIMD_SPLIT    split_avx2
+#define SIMD_TARGET   __attribute__((target("avx2,fma")))
+#define SIMD_REAL     double
+#define SIMD_VEC      __m256d
+#define SIMD_W        4
+#define SIMD_LOAD     _mm256_loadu_pd
+#define SIMD_STORE    _mm256_storeu_pd
+#define SIMD_ADD      _mm256_add_pd
+#define SIMD_SUB      _mm256_sub_pd
+#define SIMD_MUL      _mm256_mul_pd
+#define SIMD_FMADD    _mm256_fmadd_pd
+#define SIMD_FMSUB    _mm256_fmsub_pd
+#define SIMD_SET1     _mm256_set1_pd
+#define SIMD_TRANSPOSE transpose_avx2
+#define SIMD_STORE_COMPLEX(z, re, im) \
+   (_mm256_storeu_pd(&(z)[0].a, _mm256_unpacklo_pd(re, im)), \
+    _mm256_storeu_pd(&(z)[2].a, _mm256_unpackhi_pd(re, im)))
+#define SIMD_LOAD_COMPLEX  load_complex_avx2
+#define SIMD_CODELET(f) f##_avx2
+#define SIMD_STORE_NATURAL store_natural_avx2
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_avx512
+#define SIMD_DIF8     dif8_avx512
+#define SIMD_SPLIT    split_avx512
+#define SIMD_TARGET   __attribute__((target("avx512f")))
+#define SIMD_REAL     double
+#define SIMD_VEC      __m512d
+#define SIMD_W        8
+#define SIMD_LOAD     _mm512_loadu_pd
+#define SIMD_STORE    _mm512_storeu_pd
+#define SIMD_ADD      _mm512_add_pd
+#define SIMD_SUB      _mm512_sub_pd
+#define SIMD_MUL      _mm512_mul_pd
+#define SIMD_FMADD    _mm512_fmadd_pd
+#define SIMD_FMSUB    _mm512_fmsub_pd
+#define SIMD_SET1     _mm512_set1_pd
+#define SIMD_TRANSPOSE transpose_avx512
+#define SIMD_STORE_COMPLEX(z, re, im) \
+   (_mm512_storeu_pd(&(z)[0].a, _mm512_unpacklo_pd(re, im)), \
+    _mm512_storeu_pd(&(z)[4].a, _mm512_unpackhi_pd(re, im)))
+#define SIMD_LOAD_COMPLEX  load_complex_avx512
+#define SIMD_CODELET(f) f##_avx512
+#define SIMD_STORE_NATURAL store_natural_avx512
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_sse_f
+#define SIMD_TARGET   __attribute__((target("sse2")))
+#define SIMD_REAL     float
+#define SIMD_VEC      __m128
+#define SIMD_W        4
+#define SIMD_LOAD     _mm_loadu_ps
+#define SIMD_STORE    _mm_storeu_ps
+#define SIMD_ADD      _mm_add_ps
+#define SIMD_SUB      _mm_sub_ps
+#define SIMD_MUL      _mm_mul_ps
+#define SIMD_FMADD(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#define SIMD_FMSUB(a, b, c) _mm_sub_ps(_mm_mul_ps(a, b), c)
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_avx2_f
+#define SIMD_TARGET   __attribute__((target("avx2,fma")))
+#define SIMD_REAL     float
+#define SIMD_VEC      __m256
+#define SIMD_W        8
+#define SIMD_LOAD     _mm256_loadu_ps
+#define SIMD_STORE    _mm256_storeu_ps
+#define SIMD_ADD      _mm256_add_ps
+#define SIMD_SUB      _mm256_sub_ps
+#define SIMD_MUL      _mm256_mul_ps
+#define SIMD_FMADD    _mm256_fmadd_ps
+#define SIMD_FMSUB    _mm256_fmsub_ps
+#include "fft_simd_body.h"
+
+#define SIMD_FN       dif_avx512_f
+#define SIMD_TARGET   __attribute__((target("avx512f")))
+#define SIMD_REAL     float
+#define SIMD_VEC      __m512
+#define SIMD_W        16
+#define SIMD_LOAD     _mm512_loadu_ps
+#define SIMD_STORE    _mm512_storeu_ps
+#define SIMD_ADD      _mm512_add_ps
+#define SIMD_SUB      _mm512_sub_ps
+#define SIMD_MUL      _mm512_mul_ps
+#define SIMD_FMADD    _mm512_fmadd_ps
+#define SIMD_FMSUB    _mm512_fmsub_ps
+#include "fft_simd_body.h"
+
+int fft_simd_best_isa(void)
+{
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f"))
+      return FFT_ISA_AVX512;
+   if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return FFT_ISA_AVX2;
+   if (__builtin_cpu_supports("sse2"))
+      return FFT_ISA_SSE2;
+   return 0;
+}
+
+void fft_simd_dif(int isa, double *re, double *im, int n,
+                  const double *twr, const double *twi)
+{
+   switch (isa)
+   {
+   case FFT_ISA_AVX512:
+      dif_avx512(re, im, n, twr, twi);
+      break;
+   case FFT_ISA_AVX2:
+      dif_avx2(re, im, n, twr, twi);
+      break;
+   case FFT_ISA_SSE2:
+      dif_sse2(re, im, n, twr, twi);
+      break;
+   default:
+      dif_scalar(re, im, n, twr, twi);
+      break;
+   }
+}
+
+void fft_simd_dif8(int isa, const double *re, const double *im, int n,
+                   struct Complex *out, const int *rev)
+{
+   // Narrower vectors for lengths too short to fill the wide ones.
+   if (isa == FFT_ISA_AVX512 && n % 64 != 0)
+      isa = FFT_ISA_AVX2;
+   if (isa == FFT_ISA_AVX2 && n % 32 != 0)
+      isa = FFT_ISA_SSE2;
+   switch (isa)
+   {
+   case FFT_ISA_AVX512:
+      dif8_avx512(re, im, n, out, rev);
+      break;
+   case FFT_ISA_AVX2:
+      dif8_avx2(re, im, n, out, rev);
+      break;
+   case FFT_ISA_SSE2:
+      dif8_sse2(re, im, n, out, rev);
+      break;
+   default:
+      dif8_scalar(re, im, n, out, rev);
+      break;
+   }
+}
+
+void fft_simd_split(int isa, const struct Complex *in, double *re,
+                    double *im, int n)
+{
+   if (isa == FFT_ISA_AVX512 && n % 8 != 0)
+      isa = FFT_ISA_AVX2;
+   if (isa == FFT_ISA_AVX2 && n % 4 != 0)
+      isa = FFT_ISA_SSE2;
+   if (isa == FFT_ISA_SSE2 && n % 2 != 0)
+      isa = 0;
+   switch (isa)
+   {
+   case FFT_ISA_AVX512:
+      split_avx512(in, re, im, n);
+      break;
+   case FFT_ISA_AVX2:
+      split_avx2(in, re, im, n);
+      break;
+   case FFT_ISA_SSE2:
+      split_sse2(in, re, im, n);
+      break;
+   default:
+      split_scalar(in, re, im, n);
+      break;
+   }
+}
+
+void fft_simd_codelet(int isa, int n, int inverse, const struct Complex *in,
+                      struct Complex *out, double *work)
+{
+   switch (isa)
+   {
+   case FFT_ISA_AVX512:
+      codelet_avx512(n, inverse, in, out, work);
+      break;
+   case FFT_ISA_AVX2:
+      codelet_avx2(n, inverse, in, out, work);
+      break;
+   case FFT_ISA_SSE2:
+      codelet_sse2(n, inverse, in, out, work);
+      break;
+   default:
+      codelet_scalar(n, inverse, in, out, work);
+      break;
+   }
+}
+
+void fft_simd_dif_float(int isa, float *re, float *im, int n,
+                        const float *twr, const float *twi)
+{
+   switch (isa)
+   {
+   case FFT_ISA_AVX512:
+      dif_avx512_f(re, im, n, twr, twi);
+      break;
+   case FFT_ISA_AVX2:
+      dif_avx2_f(re, im, n, twr, twi);
+      break;
+   case FFT_ISA_SSE2:
+      dif_sse_f(re, im, n, twr, twi);
+      break;
+   default:
+      dif_scalar_f(re, im, n, twr, twi);
+      break;
+   }
+}
+
+#else
+
+int fft_simd_best_isa(void)
+{
+   return 0;
+}
+
+void fft_simd_dif(int isa, double *re, double *im, int n,
+                  const double *twr, const double *twi)
+{
+   (void)isa;
+   dif_scalar(re, im, n, twr, twi);
+}
+
+void fft_simd_dif8(int isa, const double *re, const double *im, int n,
+                   struct Complex *out, const int *rev)
+{
+   (void)isa;
+   dif8_scalar(re, im, n, out, rev);
+}
+
+void fft_simd_split(int isa, const struct Complex *in, double *re,
+                    double *im, int n)
+{
+   (void)isa;
+   split_scalar(in, re, im, n);
+}
+
+void fft_simd_codelet(int isa, int n, int inverse, const struct Complex *in,
+                      struct Complex *out, double *work)
+{
+   (void)isa;
+   codelet_scalar(n, inverse, in, out, work);
+}
+
+void fft_simd_dif_float(int isa, float *re, float *im, int n,
+                        const float *twr, const float *twi)
+{
+   (void)isa;
+   dif_scalar_f(re, im, n, twr, twi);
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * fft_simd_body.h
+ *
+ * Vectorised DIF passes on split real/imaginary data.  Not a normal
+ * header: fft_simd.c includes it once per instruction set and precision,
+ * after defining
+ *
+ *   SIMD_FN       name of the function to generate
+ *   SIMD_TARGET   __attribute__((target(...))) for that instruction set
+ *   SIMD_REAL     double or float
+ *   SIMD_VEC      vector of SIMD_REAL, SIMD_W lanes wide
+ *   SIMD_LOAD, SIMD_STORE, SIMD_ADD, SIMD_SUB, SIMD_MUL
+ *   SIMD_FMADD(a, b, c)  a*b + c
+ *   SIMD_FMSUB(a, b, c)  a*b - c
+ *
+ * and, for the double builds, which also get the 8-point finishing codelet
+ * below,
+ *
+ *   SIMD_DIF8     name of the codelet function
+ *   SIMD_SPLIT    name of the function that splits the input
+ *   SIMD_SET1(x)         all lanes x
+ *   SIMD_TRANSPOSE(v)    transposes v[0..SIMD_W-1] as a SIMD_W x SIMD_W
+ *                        matrix, vector i being row i
+ *   SIMD_STORE_COMPLEX(z, re, im)  stores lanes 0, 2, 4, ... of re and im
+ *                        as struct Complex to z[0..SIMD_W/2-1] and lanes
+ *                        1, 3, 5, ... after them (the unpack order)
+ *   SIMD_LOAD_COMPLEX(z, re, im)  loads z[0..SIMD_W-1] into re and im, in
+ *                        order
+ *
+ * and, for the FFT_CODELET kernels of fft_codelets.h (see gen_codelets.c),
+ *
+ *   SIMD_CODELET(name)   name with the instruction set appended
+ *   SIMD_STORE_NATURAL(z, re, im)  stores re and im as struct Complex to
+ *                        z[0..SIMD_W-1], in order
+ *
+ * Every pass handled here has at least 8 butterflies per group.  That is a
+ * multiple of SIMD_W except for 16-lane float vectors, which is what the
+ * scalar remainder loops are for.  SIMD_TARGET may be empty and SIMD_W may
+ * be 1, which gives the plain C version.
+ */
+
+SIMD_TARGET
+static void SIMD_FN(SIMD_REAL *re, SIMD_REAL *im, int n,
+                    const SIMD_REAL *twr, const SIMD_REAL *twi)
+{
+   SIMD_VEC ar, ai, br, bi, cr, ci, dr, di, tr, ti, wr, wi;
+   SIMD_REAL Ar, Ai, Br, Bi, Cr, Ci, Dr, Di, Tr, Ti, Wr, Wi;
+   int LE, LE1, q, i, j, passes = 0;
+
+   for (LE = n; LE >= 16; LE /= 2)
+      passes++;
+   LE = n;
+   if (passes % 2)
+   {
+      // Odd number of radix-2 passes to do: one on its own first.
+      LE1 = n / 2;
+      for (j = 0; j + SIMD_W <= LE1; j += SIMD_W)
+      {
+         ar = SIMD_LOAD(re + j);
+         ai = SIMD_LOAD(im + j);
+         br = SIMD_LOAD(re + j + LE1);
+         bi = SIMD_LOAD(im + j + LE1);
+         wr = SIMD_LOAD(twr + j);
+         wi = SIMD_LOAD(twi + j);
+         SIMD_STORE(re + j, SIMD_ADD(ar, br));
+         SIMD_STORE(im + j, SIMD_ADD(ai, bi));
+         dr = SIMD_SUB(ar, br);
+         di = SIMD_SUB(ai, bi);
+         SIMD_STORE(re + j + LE1, SIMD_FMSUB(dr, wr, SIMD_MUL(di, wi)));
+         SIMD_STORE(im + j + LE1, SIMD_FMADD(dr, wi, SIMD_MUL(di, wr)));
+      }
+      for (; j < LE1; j++)
+      {
+         Dr = re[j] - re[j + LE1];
+         Di = im[j] - im[j + LE1];
+         re[j] = re[j] + re[j + LE1];
+         im[j] = im[j] + im[j + LE1];
+         re[j + LE1] = Dr * twr[j] - Di * twi[j];
+         im[j + LE1] = Dr * twi[j] + Di * twr[j];
+      }
+      twr += LE1;
+      twi += LE1;
+      LE = LE1;
+   }
+
+   // Radix-4 passes, same butterfly as radix4_dif() in fft.c.  The
+   // twiddles for each pass are W^j, W^2j and W^3j, q of each.
+   for (; LE >= 32; LE /= 4)
+   {
+      q = LE / 4;
+      for (i = 0; i < n; i = i + LE)
+      {
+         SIMD_REAL *r0 = re + i, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+         SIMD_REAL *i0 = im + i, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+
+         for (j = 0; j + SIMD_W <= q; j += SIMD_W)
+         {
+            ar = SIMD_LOAD(r0 + j);
+            ai = SIMD_LOAD(i0 + j);
+            br = SIMD_LOAD(r2 + j);
+            bi = SIMD_LOAD(i2 + j);
+            cr = SIMD_LOAD(r1 + j);
+            ci = SIMD_LOAD(i1 + j);
+            dr = SIMD_LOAD(r3 + j);
+            di = SIMD_LOAD(i3 + j);
+
+            tr = SIMD_ADD(ar, br);        // A = x0 + x2
+            ti = SIMD_ADD(ai, bi);
+            br = SIMD_SUB(ar, br);        // B = x0 - x2
+            bi = SIMD_SUB(ai, bi);
+            ar = tr;
+            ai = ti;
+            tr = SIMD_ADD(cr, dr);        // C = x1 + x3
+            ti = SIMD_ADD(ci, di);
+            wr = SIMD_SUB(ci, di);        // D = -i(x1 - x3)
+            di = SIMD_SUB(dr, cr);
+            dr = wr;
+            cr = tr;
+            ci = ti;
+
+            SIMD_STORE(r0 + j, SIMD_ADD(ar, cr));
+            SIMD_STORE(i0 + j, SIMD_ADD(ai, ci));
+
+            tr = SIMD_SUB(ar, cr);
+            ti = SIMD_SUB(ai, ci);
+            wr = SIMD_LOAD(twr + q + j);
+            wi = SIMD_LOAD(twi + q + j);
+            SIMD_STORE(r1 + j, SIMD_FMSUB(tr, wr, SIMD_MUL(ti, wi)));
+            SIMD_STORE(i1 + j, SIMD_FMADD(tr, wi, SIMD_MUL(ti, wr)));
+
+            tr = SIMD_ADD(br, dr);
+            ti = SIMD_ADD(bi, di);
+            wr = SIMD_LOAD(twr + j);
+            wi = SIMD_LOAD(twi + j);
+            SIMD_STORE(r2 + j, SIMD_FMSUB(tr, wr, SIMD_MUL(ti, wi)));
+            SIMD_STORE(i2 + j, SIMD_FMADD(tr, wi, SIMD_MUL(ti, wr)));
+
+            tr = SIMD_SUB(br, dr);
+            ti = SIMD_SUB(bi, di);
+            wr = SIMD_LOAD(twr + 2 * q + j);
+            wi = SIMD_LOAD(twi + 2 * q + j);
+            SIMD_STORE(r3 + j, SIMD_FMSUB(tr, wr, SIMD_MUL(ti, wi)));
+            SIMD_STORE(i3 + j, SIMD_FMADD(tr, wi, SIMD_MUL(ti, wr)));
+         }
+         for (; j < q; j++)
+         {
+            Ar = r0[j] + r2[j];
+            Ai = i0[j] + i2[j];
+            Br = r0[j] - r2[j];
+            Bi = i0[j] - i2[j];
+            Cr = r1[j] + r3[j];
+            Ci = i1[j] + i3[j];
+            Dr = i1[j] - i3[j];
+            Di = r3[j] - r1[j];
+
+            r0[j] = Ar + Cr;
+            i0[j] = Ai + Ci;
+
+            Tr = Ar - Cr;
+            Ti = Ai - Ci;
+            Wr = twr[q + j];
+            Wi = twi[q + j];
+            r1[j] = Tr * Wr - Ti * Wi;
+            i1[j] = Tr * Wi + Ti * Wr;
+
+            Tr = Br + Dr;
+            Ti = Bi + Di;
+            Wr = twr[j];
+            Wi = twi[j];
+            r2[j] = Tr * Wr - Ti * Wi;
+            i2[j] = Tr * Wi + Ti * Wr;
+
+            Tr = Br - Dr;
+            Ti = Bi - Di;
+            Wr = twr[2 * q + j];
+            Wi = twi[2 * q + j];
+            r3[j] = Tr * Wr - Ti * Wi;
+            i3[j] = Tr * Wi + Ti * Wr;
+         }
+      }
+      twr += 3 * q;
+      twi += 3 * q;
+   }
+}
+
+#ifdef SIMD_DIF8
+/* re[i] = in[i].a, im[i] = in[i].b, for n a multiple of SIMD_W. */
+SIMD_TARGET
+static void SIMD_SPLIT(const struct Complex *in, SIMD_REAL *re,
+                       SIMD_REAL *im, int n)
+{
+   SIMD_VEC vr, vi;
+   int i;
+
+   for (i = 0; i < n; i += SIMD_W)
+   {
+      SIMD_LOAD_COMPLEX(in + i, vr, vi);
+      SIMD_STORE(re + i, vr);
+      SIMD_STORE(im + i, vi);
+   }
+}
+
+/* The last three passes (LE = 8, 4, 2) and the bit-reversed store into out,
+   written out by hand on SIMD_W blocks of 8 points at once.  The blocks
+   are transposed so that vector k holds point k of every block, the
+   8-point butterflies run straight down the lanes with the 8th roots of
+   unity as constants, and the results are written out lane by lane.  n
+   must be a multiple of 8 * SIMD_W. */
+SIMD_TARGET
+static void SIMD_DIF8(const SIMD_REAL *re, const SIMD_REAL *im, int n,
+                      struct Complex *out, const int *rev)
+{
+   const SIMD_VEC c = SIMD_SET1(M_SQRT1_2);
+   SIMD_VEC xr[8], xi[8], ar[4], ai[4], br[4], bi[4], dr, di;
+   struct Complex y[8][SIMD_W];
+   const int *r;
+   int b, k, l;
+
+   for (b = 0; b < n; b += 8 * SIMD_W)
+   {
+      #pragma GCC unroll 8
+      for (k = 0; k < 8; k += SIMD_W)
+      {
+         #pragma GCC unroll 8
+         for (l = 0; l < SIMD_W; l++)
+         {
+            xr[k + l] = SIMD_LOAD(re + b + 8 * l + k);
+            xi[k + l] = SIMD_LOAD(im + b + 8 * l + k);
+         }
+         SIMD_TRANSPOSE(xr + k);
+         SIMD_TRANSPOSE(xi + k);
+      }
+
+      // LE = 8: a = x[k] + x[k+4], b = (x[k] - x[k+4]) W8^k
+      #pragma GCC unroll 8
+      for (k = 0; k < 4; k++)
+      {
+         ar[k] = SIMD_ADD(xr[k], xr[k + 4]);
+         ai[k] = SIMD_ADD(xi[k], xi[k + 4]);
+      }
+      br[0] = SIMD_SUB(xr[0], xr[4]);
+      bi[0] = SIMD_SUB(xi[0], xi[4]);
+      dr = SIMD_SUB(xr[1], xr[5]);
+      di = SIMD_SUB(xi[1], xi[5]);
+      br[1] = SIMD_MUL(c, SIMD_ADD(dr, di));
+      bi[1] = SIMD_MUL(c, SIMD_SUB(di, dr));
+      br[2] = SIMD_SUB(xi[2], xi[6]);
+      bi[2] = SIMD_SUB(xr[6], xr[2]);
+      dr = SIMD_SUB(xr[3], xr[7]);
+      di = SIMD_SUB(xi[3], xi[7]);
+      br[3] = SIMD_MUL(c, SIMD_SUB(di, dr));
+      bi[3] = SIMD_MUL(c, SIMD_SUB(SIMD_SUB(xr[7], xr[3]), di));
+
+      // LE = 4 on each half, twiddles 1 and -i, into xr/xi
+      xr[0] = SIMD_ADD(ar[0], ar[2]);  xi[0] = SIMD_ADD(ai[0], ai[2]);
+      xr[1] = SIMD_ADD(ar[1], ar[3]);  xi[1] = SIMD_ADD(ai[1], ai[3]);
+      xr[2] = SIMD_SUB(ar[0], ar[2]);  xi[2] = SIMD_SUB(ai[0], ai[2]);
+      xr[3] = SIMD_SUB(ai[1], ai[3]);  xi[3] = SIMD_SUB(ar[3], ar[1]);
+      xr[4] = SIMD_ADD(br[0], br[2]);  xi[4] = SIMD_ADD(bi[0], bi[2]);
+      xr[5] = SIMD_ADD(br[1], br[3]);  xi[5] = SIMD_ADD(bi[1], bi[3]);
+      xr[6] = SIMD_SUB(br[0], br[2]);  xi[6] = SIMD_SUB(bi[0], bi[2]);
+      xr[7] = SIMD_SUB(bi[1], bi[3]);  xi[7] = SIMD_SUB(br[3], br[1]);
+
+      // LE = 2, in bit-reversed order
+      #pragma GCC unroll 8
+      for (k = 0; k < 8; k += 2)
+      {
+         SIMD_STORE_COMPLEX(y[k], SIMD_ADD(xr[k], xr[k + 1]),
+                            SIMD_ADD(xi[k], xi[k + 1]));
+         SIMD_STORE_COMPLEX(y[k + 1], SIMD_SUB(xr[k], xr[k + 1]),
+                            SIMD_SUB(xi[k], xi[k + 1]));
+      }
+      #pragma GCC unroll 8
+      for (l = 0; l < SIMD_W; l++)
+      {
+         r = rev + b + 8 * l;
+         #pragma GCC unroll 8
+         for (k = 0; k < 8; k++)
+            out[r[k]] = y[k][(l % 2) * (SIMD_W / 2) + l / 2];
+      }
+   }
+}
+#endif
+
+#ifdef SIMD_CODELET
+#include "fft_codelets.h"
+#endif
+
+#undef SIMD_FN
+#undef SIMD_TARGET
+#undef SIMD_REAL
+#undef SIMD_VEC
+#undef SIMD_W
+#undef SIMD_LOAD
+#undef SIMD_STORE
+#undef SIMD_ADD
+#undef SIMD_SUB
+#undef SIMD_MUL
+#undef SIMD_FMADD
+#undef SIMD_FMSUB
+#undef SIMD_DIF8
+#undef SIMD_SPLIT
+#undef SIMD_LOAD_COMPLEX
+#undef SIMD_SET1
+#undef SIMD_TRANSPOSE
+#undef SIMD_STORE_COMPLEX
+#undef SIMD_CODELET
+#undef SIMD_STORE_NATURAL
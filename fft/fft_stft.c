@@ -0,0 +1,141 @@
+/*
+ * fft_stft.c
+ *
+ * Short-time Fourier transform of a sample stream: a window of n samples
+ * slides along the input hop samples at a time, and each position gives
+ * one column of the spectrogram, |X[k]| / n for k = 0..n/2.
+ *
+ * Samples are fed in chunks of any size.  The last n samples seen are
+ * kept in hist; every time hop new ones have come in (n for the first
+ * frame), hist is transformed with one real FFT, the window being applied
+ * as the FFT packs its input.  The plan and every buffer are made once in
+ * fft_stft_create() and the window table is the shared one of
+ * fft_window.c, so a stream of any length costs no allocation.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft_internal.h"
+
+struct fft_stft
+{
+   int n, hop, window;
+   fft_real_plan *plan;
+   const double *win;         // window[i], i < n
+   double *hist;              // the last n samples, oldest first
+   int fill;                  // valid samples in hist
+   int due;                   // samples still needed for the next frame
+   struct Complex *X;         // n/2 + 1 bins
+   struct Complex *work;
+};
+
+
+fft_stft *fft_stft_create(int n, int hop, int window)
+{
+   fft_stft *s;
+
+   if (hop < 1 || !fft_window_get(window, n, 0.0))
+      return NULL;
+   s = calloc(1, sizeof(*s));
+   if (!s)
+      return NULL;
+   s->n = n;
+   s->hop = hop;
+   s->window = window;
+   s->plan = fft_real_plan_create(n, FFT_SIMD);
+   if (!s->plan)
+   {
+      free(s);
+      return NULL;
+   }
+   s->win = fft_window_get(window, n, 0.0)->w;
+   s->hist = malloc(n * sizeof(*s->hist));
+   s->X = malloc((n / 2 + 1) * sizeof(*s->X));
+   s->work = malloc(fft_real_work_size(s->plan) * sizeof(*s->work));
+   if (!s->hist || !s->X || !s->work)
+   {
+      fft_stft_destroy(s);
+      return NULL;
+   }
+   fft_stft_reset(s);
+   return s;
+}
+
+void fft_stft_destroy(fft_stft *s)
+{
+   if (!s)
+      return;
+   fft_real_plan_destroy(s->plan);
+   free(s->hist);
+   free(s->X);
+   free(s->work);
+   free(s);
+}
+
+void fft_stft_reset(fft_stft *s)
+{
+   s->fill = 0;
+   s->due = s->n;
+}
+
+int fft_stft_bins(const fft_stft *s)
+{
+   return s->n / 2 + 1;
+}
+
+int fft_stft_max_frames(const fft_stft *s, int count)
+{
+   if (count < s->due)
+      return 0;
+   return (count - s->due) / s->hop + 1;
+}
+
+/* Windows hist, transforms it and writes the magnitudes to out. */
+static void emit_frame(fft_stft *s, float *out)
+{
+   int i;
+
+   fft_execute_r2c_window_work(s->plan, s->hist, s->win, s->X, s->work);
+   for (i = 0; i <= s->n / 2; i++)
+      out[i] = hypot(s->X[i].a, s->X[i].b) / s->n;
+}
+
+int fft_stft_process(fft_stft *s, const double *in, int count, float *out)
+{
+   int frames = 0, take, keep;
+
+   while (count > 0)
+   {
+      if (s->due > s->n)
+      {
+         // hop > n: samples between frames are never looked at.
+         take = count < s->due - s->n ? count : s->due - s->n;
+         s->fill = 0;
+         s->due -= take;
+         in += take;
+         count -= take;
+         continue;
+      }
+      take = count < s->due ? count : s->due;
+      if (s->fill + take > s->n)
+      {
+         // Slide out the oldest samples to make room.
+         keep = s->n - take;
+         memmove(s->hist, s->hist + s->fill - keep, keep * sizeof(*s->hist));
+         s->fill = keep;
+      }
+      memcpy(s->hist + s->fill, in, take * sizeof(*in));
+      s->fill += take;
+      s->due -= take;
+      in += take;
+      count -= take;
+      if (s->due == 0)
+      {
+         emit_frame(s, out + (size_t)frames * (s->n / 2 + 1));
+         frames++;
+         s->due = s->hop;
+      }
+   }
+   return frames;
+}
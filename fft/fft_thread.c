@@ -0,0 +1,176 @@
+/*
+ * fft_thread.c
+ *
+ * A small pthread pool for the multi-threaded parts of the FFT engine.
+ * The threads are started once and then sleep on a condition variable
+ * between jobs, so handing out work costs a wake-up rather than a
+ * pthread_create() per call.
+ *
+ * A job is count independent tasks.  The calling thread works on the job
+ * too, and fft_pool_run() only returns once every task has finished.  Each
+ * task is told which slot (0 for the caller, 1..nthreads for the workers)
+ * it is running in, so callers can keep one scratch buffer per slot.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fft_internal.h"
+
+struct fft_pool
+{
+   int nthreads;                // worker threads, not counting the caller
+   pthread_t *threads;
+   pthread_mutex_t lock;
+   pthread_cond_t start;        // a new job is up, or quit is set
+   pthread_cond_t done;         // the last task of the job has finished
+
+   void (*fn)(void *arg, int task, int slot);
+   void *arg;
+   int count;                   // tasks in the current job
+   int next;                    // next task to hand out
+   int finished;                // tasks completed
+   unsigned generation;         // bumped for every job, wrapping
+   int quit;
+};
+
+struct worker_arg
+{
+   fft_pool *pool;
+   int slot;
+};
+
+
+int fft_num_cpus(void)
+{
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n < 1 ? 1 : (int)n;
+}
+
+/* Hands out tasks of the current job until there are none left.  Called
+   and returns with the lock held. */
+static void run_tasks(fft_pool *pool, int slot)
+{
+   int task;
+
+   while (pool->next < pool->count)
+   {
+      task = pool->next++;
+      pthread_mutex_unlock(&pool->lock);
+      pool->fn(pool->arg, task, slot);
+      pthread_mutex_lock(&pool->lock);
+      if (++pool->finished == pool->count)
+         pthread_cond_broadcast(&pool->done);
+   }
+}
+
+static void *worker(void *p)
+{
+   struct worker_arg *wa = p;
+   fft_pool *pool = wa->pool;
+   int slot = wa->slot;
+   unsigned generation = 0;
+
+   free(wa);
+   pthread_mutex_lock(&pool->lock);
+   for (;;)
+   {
+      while (!pool->quit && pool->generation == generation)
+         pthread_cond_wait(&pool->start, &pool->lock);
+      if (pool->quit)
+         break;
+      generation = pool->generation;
+      run_tasks(pool, slot);
+   }
+   pthread_mutex_unlock(&pool->lock);
+   return NULL;
+}
+
+fft_pool *fft_pool_create(int nthreads)
+{
+   fft_pool *pool;
+   struct worker_arg *wa;
+   int i;
+
+   if (nthreads <= 0)
+      nthreads = fft_num_cpus();
+   pool = calloc(1, sizeof(*pool));
+   if (!pool)
+      return NULL;
+   pthread_mutex_init(&pool->lock, NULL);
+   pthread_cond_init(&pool->start, NULL);
+   pthread_cond_init(&pool->done, NULL);
+   pool->threads = malloc(nthreads * sizeof(*pool->threads));
+   if (!pool->threads)
+   {
+      fft_pool_destroy(pool);
+      return NULL;
+   }
+
+   // The caller is one of the threads, so start one fewer.
+   for (i = 0; i < nthreads - 1; i++)
+   {
+      wa = malloc(sizeof(*wa));
+      if (!wa)
+         break;
+      wa->pool = pool;
+      wa->slot = i + 1;
+      if (pthread_create(&pool->threads[i], NULL, worker, wa) != 0)
+      {
+         free(wa);
+         break;
+      }
+      pool->nthreads++;
+   }
+   return pool;
+}
+
+void fft_pool_destroy(fft_pool *pool)
+{
+   int i;
+
+   if (!pool)
+      return;
+   pthread_mutex_lock(&pool->lock);
+   pool->quit = 1;
+   pthread_cond_broadcast(&pool->start);
+   pthread_mutex_unlock(&pool->lock);
+   for (i = 0; i < pool->nthreads; i++)
+      pthread_join(pool->threads[i], NULL);
+   pthread_mutex_destroy(&pool->lock);
+   pthread_cond_destroy(&pool->start);
+   pthread_cond_destroy(&pool->done);
+   free(pool->threads);
+   free(pool);
+}
+
+int fft_pool_slots(const fft_pool *pool)
+{
+   return pool ? pool->nthreads + 1 : 1;
+}
+
+void fft_pool_run(fft_pool *pool, void (*fn)(void *arg, int task, int slot),
+                  void *arg, int count)
+{
+   int task;
+
+   if (!pool || pool->nthreads == 0 || count <= 1)
+   {
+      for (task = 0; task < count; task++)
+         fn(arg, task, 0);
+      return;
+   }
+
+   pthread_mutex_lock(&pool->lock);
+   pool->fn = fn;
+   pool->arg = arg;
+   pool->count = count;
+   pool->next = 0;
+   pool->finished = 0;
+   pool->generation++;
+   pthread_cond_broadcast(&pool->start);
+   run_tasks(pool, 0);
+   while (pool->finished < pool->count)
+      pthread_cond_wait(&pool->done, &pool->lock);
+   pthread_mutex_unlock(&pool->lock);
+}
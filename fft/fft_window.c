@@ -0,0 +1,133 @@
+/*
+ * fft_window.c
+ *
+ * Window tables for spectral analysis.  A table is computed the first time
+ * a (window, n, beta) is asked for and kept for the rest of the process,
+ * so frames after the first cost nothing but the multiplies, and those
+ * are done in the packing loop of the real transform
+ * (fft_execute_r2c_window_work()) rather than as a pass of their own.
+ *
+ * All windows are in the periodic form, w[i] for i = 0..n-1 taken from a
+ * window of n+1 points with the last one dropped, which is what a DFT
+ * frame wants and what overlapping frames add up correctly with.  The
+ * cosine-sum windows are
+ *
+ *    w[i] = a0 - a1 cos(t) + a2 cos(2t) - a3 cos(3t) + a4 cos(4t),
+ *    t = 2 pi i / n
+ *
+ * with the coefficients below, and the Kaiser window is
+ *
+ *    w[i] = I0(beta sqrt(1 - (2i/n - 1)^2)) / I0(beta).
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "fft.h"
+
+#define KAISER_BETA 8.6   // default beta, between Blackman and Blackman-Harris
+
+struct cached
+{
+   struct fft_window win;
+   struct cached *next;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct cached *cache;
+
+/* a0..a4 of each cosine-sum window, by FFT_WINDOW_*. */
+static const double cosine_sum[][5] =
+{
+   { 1.0 },                                                    // rect
+   { 0.5, 0.5 },                                               // Hann
+   { 0.54, 0.46 },                                             // Hamming
+   { 0.42, 0.5, 0.08 },                                        // Blackman
+   { 0.35875, 0.48829, 0.14128, 0.01168 },                     // B-Harris
+   { 0.21557895, 0.41663158, 0.277263158, 0.083578947,
+     0.006947368 },                                            // flat top
+};
+
+
+/* Modified Bessel function of the first kind, order 0, from its power
+   series; the terms shrink fast enough for any beta a window would use. */
+static double bessel_i0(double x)
+{
+   double sum = 1.0, term = 1.0, q = x * x / 4;
+   int k;
+
+   for (k = 1; term > sum * 1e-17; k++)
+   {
+      term *= q / ((double)k * k);
+      sum += term;
+   }
+   return sum;
+}
+
+static void fill(struct fft_window *win, double *w)
+{
+   const double *a = cosine_sum[win->type];
+   double t, x, i0, sum = 0.0, sum2 = 0.0;
+   int n = win->n, i;
+
+   i0 = bessel_i0(win->beta);
+   for (i = 0; i < n; i++)
+   {
+      if (win->type == FFT_WINDOW_KAISER)
+      {
+         x = 2.0 * i / n - 1.0;
+         w[i] = bessel_i0(win->beta * sqrt(1.0 - x * x)) / i0;
+      }
+      else
+      {
+         t = 2.0 * M_PI * i / n;
+         w[i] = a[0] - a[1] * cos(t) + a[2] * cos(2 * t) - a[3] * cos(3 * t) +
+                a[4] * cos(4 * t);
+      }
+      sum += w[i];
+      sum2 += w[i] * w[i];
+   }
+   win->coherent_gain = sum / n;
+   win->enbw = n * sum2 / (sum * sum);
+}
+
+const struct fft_window *fft_window_get(int type, int n, double beta)
+{
+   struct cached *c;
+   double *w;
+
+   if (type < FFT_WINDOW_RECT || type > FFT_WINDOW_KAISER || n < 1)
+      return NULL;
+   if (type != FFT_WINDOW_KAISER)
+      beta = 0.0;
+   else if (beta <= 0.0)
+      beta = KAISER_BETA;
+
+   pthread_mutex_lock(&lock);
+   for (c = cache; c; c = c->next)
+      if (c->win.type == type && c->win.n == n && c->win.beta == beta)
+         break;
+   if (!c)
+   {
+      c = malloc(sizeof(*c));
+      w = malloc(n * sizeof(*w));
+      if (c && w)
+      {
+         c->win.type = type;
+         c->win.n = n;
+         c->win.beta = beta;
+         c->win.w = w;
+         fill(&c->win, w);
+         c->next = cache;
+         cache = c;
+      }
+      else
+      {
+         free(c);
+         free(w);
+         c = NULL;
+      }
+   }
+   pthread_mutex_unlock(&lock);
+   return c ? &c->win : NULL;
+}
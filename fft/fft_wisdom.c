@@ -0,0 +1,298 @@
+/*
+ * fft_wisdom.c
+ *
+ * FFT_MEASURE planning.  Which kernel is fastest for a given length depends
+ * on the host (cache sizes, which vector units there are, how many cores),
+ * so instead of guessing, fft_plan_create() with FFT_MEASURE times every
+ * candidate on n points and keeps the winner:
+ *
+ *   FFT_RADIX2, FFT_STOCKHAM, FFT_RADIX4, FFT_SPLIT_RADIX
+ *   FFT_SIMD with each instruction set the CPU has
+ *   FFT_CODELET with each instruction set, for n from CODELET_MIN to
+ *   CODELET_MAX
+ *   FFT_FOUR_STEP on one thread and, if the caller allows more, on that
+ *   many, for n >= FOUR_STEP_MIN
+ *
+ * The choice is kept as "wisdom", one entry per (n, direction, thread
+ * limit), for the rest of the process.  fft_wisdom_save() writes it out as
+ * text and fft_wisdom_load() reads it back, so a program that loads its
+ * wisdom file at start-up and saves it at exit only measures each size
+ * the first time it ever sees it.
+ *
+ * A wisdom file is one line per entry after a comment line:
+ *
+ *    n inverse nthreads flags threads ns
+ *
+ * nthreads is the limit the plan was asked for, threads what the winner
+ * uses, flags its kernel and instruction set, and ns its measured time,
+ * kept for information only.  Entries naming an instruction set this CPU
+ * does not have are measured again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "fft_internal.h"
+
+#define FOUR_STEP_MIN (1 << 16)   // smaller rows than this fit in cache anyway
+#define TIME_BUDGET   (1 << 18)   // points transformed per trial
+
+struct wisdom
+{
+   int n;
+   int inverse;
+   int nthreads;              // thread limit of the plan that asked
+   int flags;                 // kernel and ISA of the winner
+   int threads;               // threads the winner runs on
+   double ns;                 // its time per transform
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct wisdom *table;
+static int count, capacity;
+
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Best-of-three time of one transform in ns, or -1 if the plan cannot be
+   made. */
+static double time_plan(int n, int flags, int nthreads,
+                        const struct Complex *in, struct Complex *out)
+{
+   fft_plan *plan;
+   struct Complex *work = NULL;
+   double best = -1.0, t;
+   int reps, r, trial;
+
+   plan = fft_plan_create_threaded(n, flags, nthreads);
+   if (!plan)
+      return -1.0;
+   if (fft_work_size(plan) > 0)
+   {
+      work = malloc(fft_work_size(plan) * sizeof(*work));
+      if (!work)
+      {
+         fft_plan_destroy(plan);
+         return -1.0;
+      }
+   }
+   reps = TIME_BUDGET / n;
+   if (reps < 1)
+      reps = 1;
+   fft_execute_work(plan, in, out, work);   // warm up caches and pages
+   for (trial = 0; trial < 3; trial++)
+   {
+      t = now();
+      for (r = 0; r < reps; r++)
+         fft_execute_work(plan, in, out, work);
+      t = (now() - t) / reps * 1e9;
+      if (best < 0 || t < best)
+         best = t;
+   }
+   free(work);
+   fft_plan_destroy(plan);
+   return best;
+}
+
+/* Keeps flags on threads as the winner if t beats the one so far. */
+static void consider(struct wisdom *w, int flags, int threads, double t)
+{
+   if (t >= 0 && (w->ns < 0 || t < w->ns))
+   {
+      w->flags = flags;
+      w->threads = threads;
+      w->ns = t;
+   }
+}
+
+/* Times the candidates for w->n and fills in the winner.  Returns -1 when
+   out of memory. */
+static int measure(struct wisdom *w)
+{
+   static const int isas[] = { FFT_ISA_SSE2, FFT_ISA_AVX2, FFT_ISA_AVX512 };
+   int dir = w->inverse ? FFT_INVERSE : 0;
+   int best_isa = fft_simd_best_isa();
+   struct Complex *in, *out;
+   uint32_t seed = 1;
+   int i, k;
+
+   in = malloc(w->n * sizeof(*in));
+   out = malloc(w->n * sizeof(*out));
+   if (!in || !out)
+   {
+      free(in);
+      free(out);
+      return -1;
+   }
+   // Noise from a generator of our own, leaving the caller's rand() alone.
+   for (i = 0; i < w->n; i++)
+   {
+      seed = seed * 1664525 + 1013904223;
+      in[i].a = (double)seed / UINT32_MAX - 0.5;
+      seed = seed * 1664525 + 1013904223;
+      in[i].b = (double)seed / UINT32_MAX - 0.5;
+   }
+
+   w->ns = -1.0;
+   for (k = FFT_RADIX2; k <= FFT_SPLIT_RADIX; k++)
+      consider(w, k, 1, time_plan(w->n, k | dir, 1, in, out));
+   for (k = 0; k < 3 && isas[k] <= best_isa; k++)
+      consider(w, FFT_SIMD | isas[k], 1,
+               time_plan(w->n, FFT_SIMD | isas[k] | dir, 1, in, out));
+   if (w->n >= CODELET_MIN && w->n <= CODELET_MAX)
+      for (k = 0; k < 3 && isas[k] <= best_isa; k++)
+         consider(w, FFT_CODELET | isas[k], 1,
+                  time_plan(w->n, FFT_CODELET | isas[k] | dir, 1, in, out));
+   if (w->n >= FOUR_STEP_MIN)
+   {
+      consider(w, FFT_FOUR_STEP, 1,
+               time_plan(w->n, FFT_FOUR_STEP | dir, 1, in, out));
+      if (w->nthreads != 1)
+         consider(w, FFT_FOUR_STEP, w->nthreads,
+                  time_plan(w->n, FFT_FOUR_STEP | dir, w->nthreads,
+                            in, out));
+   }
+   if (w->ns < 0)
+   {
+      // Nothing could be timed; radix-2 needs the least memory.
+      w->flags = FFT_RADIX2;
+      w->threads = 1;
+   }
+   free(in);
+   free(out);
+   return 0;
+}
+
+/* Entry for the key of w, or NULL.  Called with the lock held. */
+static struct wisdom *find(const struct wisdom *w)
+{
+   int i;
+
+   for (i = 0; i < count; i++)
+      if (table[i].n == w->n && table[i].inverse == w->inverse &&
+          table[i].nthreads == w->nthreads)
+         return &table[i];
+   return NULL;
+}
+
+/* Adds w, or replaces the entry with the same key.  Called with the lock
+   held; returns -1 when out of memory. */
+static int remember(const struct wisdom *w)
+{
+   struct wisdom *slot = find(w), *grown;
+
+   if (!slot)
+   {
+      if (count == capacity)
+      {
+         grown = realloc(table, (2 * capacity + 16) * sizeof(*table));
+         if (!grown)
+            return -1;
+         table = grown;
+         capacity = 2 * capacity + 16;
+      }
+      slot = &table[count++];
+   }
+   *slot = *w;
+   return 0;
+}
+
+int fft_wisdom_flags(int n, int flags, int *nthreads)
+{
+   struct wisdom w, *known;
+
+   w.n = n;
+   w.inverse = (flags & FFT_INVERSE) != 0;
+   w.nthreads = *nthreads;
+
+   // Held while measuring so that two threads planning the same size do
+   // not time it twice, and do not disturb each other's timings.
+   pthread_mutex_lock(&lock);
+   known = find(&w);
+   if (known && (known->flags & FFT_ISA_MASK) <= fft_simd_best_isa())
+      w = *known;
+   else if (measure(&w) < 0 || remember(&w) < 0)
+   {
+      pthread_mutex_unlock(&lock);
+      return -1;
+   }
+   pthread_mutex_unlock(&lock);
+
+   *nthreads = w.threads;
+   return w.flags | (flags & FFT_INVERSE);
+}
+
+int fft_wisdom_load(const char *path)
+{
+   struct wisdom w;
+   FILE *fp;
+   int loaded = 0, c;
+
+   fp = fopen(path, "r");
+   if (!fp)
+      return -1;
+   pthread_mutex_lock(&lock);
+   for (;;)
+   {
+      c = fgetc(fp);
+      if (c == '#')
+      {
+         while (c != '\n' && c != EOF)
+            c = fgetc(fp);
+         continue;
+      }
+      if (c == EOF)
+         break;
+      ungetc(c, fp);
+      if (fscanf(fp, "%d %d %d %i %d %lf", &w.n, &w.inverse, &w.nthreads,
+                 &w.flags, &w.threads, &w.ns) != 6)
+         break;
+      if (w.n < 1 || w.n > FFT_MAX_SIZE || (w.n & (w.n - 1)) != 0 ||
+          ((w.flags & FFT_KERNEL_MASK) > FFT_FOUR_STEP &&
+           (w.flags & FFT_KERNEL_MASK) != FFT_CODELET) || w.threads < 0)
+         continue;
+      if (remember(&w) < 0)
+         break;
+      loaded++;
+   }
+   pthread_mutex_unlock(&lock);
+   fclose(fp);
+   return loaded;
+}
+
+int fft_wisdom_save(const char *path)
+{
+   FILE *fp;
+   int i, err;
+
+   fp = fopen(path, "w");
+   if (!fp)
+      return -1;
+   pthread_mutex_lock(&lock);
+   fprintf(fp, "# fft wisdom: n inverse nthreads flags threads ns\n");
+   for (i = 0; i < count; i++)
+      fprintf(fp, "%d %d %d 0x%x %d %.0f\n", table[i].n, table[i].inverse,
+              table[i].nthreads, table[i].flags, table[i].threads,
+              table[i].ns);
+   pthread_mutex_unlock(&lock);
+   err = ferror(fp);
+   if (fclose(fp) != 0 || err)
+      return -1;
+   return 0;
+}
+
+void fft_wisdom_forget(void)
+{
+   pthread_mutex_lock(&lock);
+   free(table);
+   table = NULL;
+   count = capacity = 0;
+   pthread_mutex_unlock(&lock);
+}
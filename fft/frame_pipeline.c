@@ -0,0 +1,272 @@
+/*
+ * frame_pipeline.c
+ *
+ * Each worker has a lane: a ring of slots with three counters, frames
+ * filled by the ingest thread, done by the worker and written by the
+ * writer.  Every counter has exactly one thread that writes it, so each
+ * hand-over is single-producer, single-consumer and needs nothing more
+ * than a release store by the producer and an acquire load by the
+ * consumer.  A slot is free for the ingest thread once its frame has been
+ * written, so the slots cycle through the three stages and are never
+ * copied.
+ *
+ * Frame k goes to lane k % workers, in slot (k / workers) % slots, so the
+ * writer gets the frames back in order just by visiting the lanes in turn.
+ *
+ * The counters sit on cache lines of their own so that the threads do not
+ * steal lines from each other.  A thread with nothing to do spins briefly
+ * and then yields the CPU.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "frame_pipeline.h"
+
+#define LINE  64   // cache line size
+#define SLOTS 16   // default frames in flight per worker
+#define SPINS 100  // checks before yielding the CPU
+
+struct slot
+{
+   int64_t index;
+   const double *x;           // what read returned
+   double *buf;               // n samples for read to fill
+   struct Complex *X;
+   float *power;
+};
+
+struct lane
+{
+   _Alignas(LINE) atomic_llong filled;   // ingest thread only
+   _Alignas(LINE) atomic_llong done;     // the worker only
+   _Alignas(LINE) atomic_llong written;  // the writer only
+   _Alignas(LINE) struct slot *slots;
+   struct Complex *work;
+   struct pipeline *p;
+   pthread_t thread;
+};
+
+struct pipeline
+{
+   int n, workers, nslots;
+   fft_real_plan *plan;
+   const double *window;      // NULL for none
+   double scale;              // 1 / (n * coherent gain)
+   struct lane *lanes;
+   pipeline_read_fn read;
+   void *arg;
+   pthread_t ingest;
+   atomic_llong frames;       // total once read has run out, -1 before
+};
+
+
+/* Called each time a thread finds nothing to do. */
+static void idle(int *spins)
+{
+   if (++*spins >= SPINS)
+   {
+      *spins = 0;
+      sched_yield();
+   }
+}
+
+static void *ingest_thread(void *arg)
+{
+   struct pipeline *p = arg;
+   struct lane *l;
+   struct slot *s;
+   long long k, filled;
+   int spins = 0;
+
+   for (k = 0; ; k++)
+   {
+      l = &p->lanes[k % p->workers];
+      filled = atomic_load_explicit(&l->filled, memory_order_relaxed);
+      while (filled - atomic_load_explicit(&l->written, memory_order_acquire)
+             >= p->nslots)
+         idle(&spins);
+      s = &l->slots[filled % p->nslots];
+      s->index = k;
+      s->x = p->read(p->arg, k, s->buf);
+      if (!s->x)
+         break;
+      atomic_store_explicit(&l->filled, filled + 1, memory_order_release);
+   }
+   atomic_store_explicit(&p->frames, k, memory_order_release);
+   return NULL;
+}
+
+static void *worker_thread(void *arg)
+{
+   struct lane *l = arg;
+   struct pipeline *p = l->p;
+   const int h = p->n / 2;
+   struct slot *s;
+   long long done, frames;
+   int spins = 0, k;
+
+   for (done = 0; ; done++)
+   {
+      while (done == atomic_load_explicit(&l->filled, memory_order_acquire))
+      {
+         // Every frame of this lane is in once the total is known; filled
+         // is read again after it in case the last one came in between.
+         frames = atomic_load_explicit(&p->frames, memory_order_acquire);
+         if (frames >= 0 &&
+             done == atomic_load_explicit(&l->filled, memory_order_acquire))
+            return NULL;
+         idle(&spins);
+      }
+      s = &l->slots[done % p->nslots];
+      fft_execute_r2c_window_work(p->plan, s->x, p->window, s->X, l->work);
+      for (k = 0; k <= h; k++)
+         s->power[k] = hypot(s->X[k].a, s->X[k].b) * p->scale;
+      atomic_store_explicit(&l->done, done + 1, memory_order_release);
+   }
+}
+
+static void free_pipeline(struct pipeline *p)
+{
+   struct lane *l;
+   int w, i;
+
+   if (p->lanes)
+      for (w = 0; w < p->workers; w++)
+      {
+         l = &p->lanes[w];
+         if (l->slots)
+            for (i = 0; i < p->nslots; i++)
+            {
+               free(l->slots[i].buf);
+               free(l->slots[i].X);
+               free(l->slots[i].power);
+            }
+         free(l->slots);
+         free(l->work);
+      }
+   free(p->lanes);
+   fft_real_plan_destroy(p->plan);
+}
+
+/* Everything the frames will need, up front. */
+static int alloc_pipeline(struct pipeline *p, int flags)
+{
+   const int bins = p->n / 2 + 1;
+   struct lane *l;
+   struct slot *s;
+   int w, i;
+
+   p->plan = fft_real_plan_create(p->n, flags);
+   if (!p->plan ||
+       posix_memalign((void **)&p->lanes, LINE,
+                      p->workers * sizeof(*p->lanes)) != 0)
+   {
+      p->lanes = NULL;
+      return -1;
+   }
+   // Zeroed first, so that free_pipeline() can tell what was set up.
+   memset(p->lanes, 0, p->workers * sizeof(*p->lanes));
+   for (w = 0; w < p->workers; w++)
+   {
+      l = &p->lanes[w];
+      atomic_init(&l->filled, 0);
+      atomic_init(&l->done, 0);
+      atomic_init(&l->written, 0);
+      l->p = p;
+      l->work = malloc(fft_real_work_size(p->plan) * sizeof(*l->work));
+      l->slots = calloc(p->nslots, sizeof(*l->slots));
+      if (!l->work || !l->slots)
+         return -1;
+      for (i = 0; i < p->nslots; i++)
+      {
+         s = &l->slots[i];
+         s->buf = malloc(p->n * sizeof(*s->buf));
+         s->X = malloc(bins * sizeof(*s->X));
+         s->power = malloc(bins * sizeof(*s->power));
+         if (!s->buf || !s->X || !s->power)
+            return -1;
+      }
+   }
+   return 0;
+}
+
+int64_t frame_pipeline_run(int n, int flags, const struct fft_window *window,
+                           int workers, int slots, pipeline_read_fn read,
+                           pipeline_write_fn write, void *arg)
+{
+   struct pipeline p = { 0 };
+   struct pipeline_frame f;
+   struct lane *l;
+   struct slot *s;
+   long long k, written, frames;
+   int w, started, spins = 0;
+
+   if (workers <= 0)
+   {
+      workers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 2;
+      if (workers < 1)
+         workers = 1;
+   }
+   p.n = n;
+   p.workers = workers;
+   p.nslots = slots > 0 ? slots : SLOTS;
+   p.window = window ? window->w : NULL;
+   p.scale = 1.0 / (window ? n * window->coherent_gain : n);
+   p.read = read;
+   p.arg = arg;
+   atomic_init(&p.frames, -1);
+   if (alloc_pipeline(&p, flags) < 0)
+   {
+      free_pipeline(&p);
+      return -1;
+   }
+   for (started = 0; started < workers; started++)
+      if (pthread_create(&p.lanes[started].thread, NULL, worker_thread,
+                         &p.lanes[started]) != 0)
+         break;
+   if (started < workers ||
+       pthread_create(&p.ingest, NULL, ingest_thread, &p) != 0)
+   {
+      // Tell the workers there is nothing coming.
+      atomic_store_explicit(&p.frames, 0, memory_order_release);
+      for (w = 0; w < started; w++)
+         pthread_join(p.lanes[w].thread, NULL);
+      free_pipeline(&p);
+      return -1;
+   }
+
+   // The writer: frame k is the next one to finish in lane k % workers.
+   for (k = 0; ; k++)
+   {
+      l = &p.lanes[k % workers];
+      written = atomic_load_explicit(&l->written, memory_order_relaxed);
+      while (written == atomic_load_explicit(&l->done, memory_order_acquire))
+      {
+         frames = atomic_load_explicit(&p.frames, memory_order_acquire);
+         if (frames >= 0 && k >= frames)
+            break;
+         idle(&spins);
+      }
+      if (written == atomic_load_explicit(&l->done, memory_order_acquire))
+         break;
+      s = &l->slots[written % p.nslots];
+      f.index = s->index;
+      f.x = s->x;
+      f.X = s->X;
+      f.power = s->power;
+      write(arg, &f);
+      atomic_store_explicit(&l->written, written + 1, memory_order_release);
+   }
+
+   pthread_join(p.ingest, NULL);
+   for (w = 0; w < workers; w++)
+      pthread_join(p.lanes[w].thread, NULL);
+   frames = atomic_load(&p.frames);
+   free_pipeline(&p);
+   return frames;
+}
@@ -0,0 +1,48 @@
+/*
+ * frame_pipeline.h
+ *
+ * Runs a long capture through the real FFT as a three-stage pipeline, so
+ * that reading, transforming and writing overlap: an ingest thread reads
+ * frames, a pool of workers takes the transform and power of each, and
+ * the calling thread writes them out in frame order.  The stages pass
+ * frames through lock-free single-producer, single-consumer rings of
+ * slots allocated up front; nothing is allocated or locked per frame.
+ */
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <stdint.h>
+#include "fft.h"
+
+/* One frame as the writer sees it. */
+struct pipeline_frame
+{
+   int64_t index;              // 0, 1, 2, ... in the order read
+   const double *x;            // the n samples
+   const struct Complex *X;    // bins 0..n/2
+   const float *power;         // |X[k]| / (n * coherent gain)
+};
+
+/* Called on the ingest thread for frame 0, 1, 2, ... in turn.  Returns
+   the frame's n samples, either written into buf or anywhere else that
+   stays valid until the frame has been written (such as a mapped file),
+   or NULL when there are no more frames. */
+typedef const double *(*pipeline_read_fn)(void *arg, int64_t frame,
+                                          double *buf);
+
+/* Called on the calling thread for every frame, in order. */
+typedef void (*pipeline_write_fn)(void *arg,
+                                  const struct pipeline_frame *frame);
+
+/* Runs frames of n samples (n even) from read to write through workers
+   FFT threads (0 for one per CPU not taken by the other two stages, at
+   least 1), with slots frames in flight per worker (0 for a default).
+   flags picks the kernel as for fft_real_plan_create().  window, of n
+   points, is applied as each frame is packed for the FFT and its coherent
+   gain divided out of the power; NULL for none.  Returns the number of
+   frames, or -1 if out of memory or a thread cannot start. */
+int64_t frame_pipeline_run(int n, int flags, const struct fft_window *window,
+                           int workers, int slots, pipeline_read_fn read,
+                           pipeline_write_fn write, void *arg);
+
+#endif
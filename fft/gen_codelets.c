@@ -0,0 +1,321 @@
+/*
+ * gen_codelets.c
+ *
+ * Writes fft_codelets.h, the FFT_CODELET kernels, to stdout.  The Makefile
+ * runs it; the header is not kept in the tree.
+ *
+ * The building blocks are straight-line split-radix DFTs of 8, 16, 32 and
+ * 64 points, one statement per add, subtract or multiply, with every
+ * twiddle written in as a constant.  They work down the lanes of SIMD_VEC
+ * arrays, so SIMD_W independent DFTs run side by side.
+ *
+ * Each n from 64 to 4096 is then n = L * R with both factors one of those
+ * sizes, done in two passes with constant bounds and a twiddle table of
+ * its own, written here as exact hex-float literals:
+ *
+ *   1. L-point DFTs down the columns of x read as L x R, x[R*m + r],
+ *      SIMD_W columns at a time; element (k, r) times w^(k*r); transposed
+ *      in registers and stored as R x L in the work buffer
+ *   2. R-point DFTs down the columns of that, SIMD_W at a time, into
+ *      out[k + L*k2], which is natural order
+ *
+ * The output is written in terms of the SIMD_* macros, for
+ * fft_simd_body.h to include once per instruction set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define MAX_LEAF 64
+
+struct cval
+{
+   char re[24], im[24];
+};
+
+/* Each n with its split into L x R. */
+static const int sizes[][3] =
+{
+   { 64, 8, 8 },
+   { 128, 16, 8 },
+   { 256, 16, 16 },
+   { 512, 32, 16 },
+   { 1024, 32, 32 },
+   { 2048, 64, 32 },
+   { 4096, 64, 64 },
+};
+
+static const char *dir_name[] = { "fwd", "inv" };
+
+static int temps;
+
+
+/* dst = fn(a, b), in a new temporary. */
+static void op2(struct cval *v, int part, const char *fn, const char *a,
+                const char *b)
+{
+   char *dst = part ? v->im : v->re;
+
+   sprintf(dst, "t%d", temps++);
+   printf("   SIMD_VEC %s = %s(%s, %s);\n", dst, fn, a, b);
+}
+
+static void op3(struct cval *v, int part, const char *fn, const char *a,
+                const char *b, const char *c)
+{
+   char *dst = part ? v->im : v->re;
+
+   sprintf(dst, "t%d", temps++);
+   printf("   SIMD_VEC %s = %s(%s, %s, %s);\n", dst, fn, a, b, c);
+}
+
+static void constant(char *dst, double x)
+{
+   sprintf(dst, "t%d", temps++);
+   printf("   const SIMD_VEC %s = SIMD_SET1(%a);\n", dst, x);
+}
+
+/* v * w^e, w = e^(-+ 2 pi i / n) for sign -1 / +1. */
+static struct cval twiddle(struct cval v, int e, int n, int sign)
+{
+   struct cval t, u, p;
+   char c[24], s[24];
+   double angle;
+
+   if (e == 0)
+      return v;
+   if (8 * e == n)
+   {
+      // (1 -+ i) / sqrt(2): one add each, then a common scale
+      constant(c, M_SQRT1_2);
+      if (sign < 0)
+      {
+         op2(&t, 0, "SIMD_ADD", v.re, v.im);
+         op2(&t, 1, "SIMD_SUB", v.im, v.re);
+      }
+      else
+      {
+         op2(&t, 0, "SIMD_SUB", v.re, v.im);
+         op2(&t, 1, "SIMD_ADD", v.re, v.im);
+      }
+      op2(&u, 0, "SIMD_MUL", t.re, c);
+      op2(&u, 1, "SIMD_MUL", t.im, c);
+      return u;
+   }
+   angle = sign * 2.0 * M_PI * e / n;
+   constant(c, cos(angle));
+   constant(s, sin(angle));
+   op2(&p, 0, "SIMD_MUL", v.im, s);
+   op2(&p, 1, "SIMD_MUL", v.im, c);
+   op3(&t, 0, "SIMD_FMSUB", v.re, c, p.re);
+   op3(&t, 1, "SIMD_FMADD", v.re, s, p.im);
+   return t;
+}
+
+/* Split-radix decimation in time: X = U + w^k Z + w^3k Z', where U is the
+   DFT of the even points and Z, Z' those of x[4m+1] and x[4m+3]. */
+static void dft(int n, int sign, const struct cval *x, struct cval *X)
+{
+   struct cval ev[MAX_LEAF / 2] = { 0 }, o1[MAX_LEAF / 4] = { 0 };
+   struct cval o3[MAX_LEAF / 4] = { 0 };
+   struct cval U[MAX_LEAF / 2], Z[MAX_LEAF / 4], Z3[MAX_LEAF / 4];
+   struct cval a, b, s, d;
+   int k;
+
+   if (n == 1)
+   {
+      X[0] = x[0];
+      return;
+   }
+   if (n == 2)
+   {
+      op2(&X[0], 0, "SIMD_ADD", x[0].re, x[1].re);
+      op2(&X[0], 1, "SIMD_ADD", x[0].im, x[1].im);
+      op2(&X[1], 0, "SIMD_SUB", x[0].re, x[1].re);
+      op2(&X[1], 1, "SIMD_SUB", x[0].im, x[1].im);
+      return;
+   }
+   for (k = 0; k < n / 2; k++)
+      ev[k] = x[2 * k];
+   for (k = 0; k < n / 4; k++)
+   {
+      o1[k] = x[4 * k + 1];
+      o3[k] = x[4 * k + 3];
+   }
+   dft(n / 2, sign, ev, U);
+   dft(n / 4, sign, o1, Z);
+   dft(n / 4, sign, o3, Z3);
+
+   for (k = 0; k < n / 4; k++)
+   {
+      a = twiddle(Z[k], k, n, sign);
+      b = twiddle(Z3[k], 3 * k, n, sign);
+      op2(&s, 0, "SIMD_ADD", a.re, b.re);
+      op2(&s, 1, "SIMD_ADD", a.im, b.im);
+      op2(&d, 0, "SIMD_SUB", a.re, b.re);
+      op2(&d, 1, "SIMD_SUB", a.im, b.im);
+      op2(&X[k], 0, "SIMD_ADD", U[k].re, s.re);
+      op2(&X[k], 1, "SIMD_ADD", U[k].im, s.im);
+      op2(&X[k + n / 2], 0, "SIMD_SUB", U[k].re, s.re);
+      op2(&X[k + n / 2], 1, "SIMD_SUB", U[k].im, s.im);
+      // w^(n/4) = -+i, so the odd terms turn a quarter either way
+      if (sign < 0)
+      {
+         op2(&X[k + n / 4], 0, "SIMD_ADD", U[k + n / 4].re, d.im);
+         op2(&X[k + n / 4], 1, "SIMD_SUB", U[k + n / 4].im, d.re);
+         op2(&X[k + 3 * n / 4], 0, "SIMD_SUB", U[k + n / 4].re, d.im);
+         op2(&X[k + 3 * n / 4], 1, "SIMD_ADD", U[k + n / 4].im, d.re);
+      }
+      else
+      {
+         op2(&X[k + n / 4], 0, "SIMD_SUB", U[k + n / 4].re, d.im);
+         op2(&X[k + n / 4], 1, "SIMD_ADD", U[k + n / 4].im, d.re);
+         op2(&X[k + 3 * n / 4], 0, "SIMD_ADD", U[k + n / 4].re, d.im);
+         op2(&X[k + 3 * n / 4], 1, "SIMD_SUB", U[k + n / 4].im, d.re);
+      }
+   }
+}
+
+/* n-point DFT of xr/xi[0..n-1] in place, lane by lane. */
+static void leaf(int n, int inverse)
+{
+   struct cval x[MAX_LEAF] = { 0 }, X[MAX_LEAF];
+   int k;
+
+   printf("SIMD_TARGET\n"
+          "static inline void SIMD_CODELET(dft%d_%s)(SIMD_VEC *xr, "
+          "SIMD_VEC *xi)\n{\n", n, dir_name[inverse]);
+   for (k = 0; k < n; k++)
+   {
+      sprintf(x[k].re, "xr[%d]", k);
+      sprintf(x[k].im, "xi[%d]", k);
+   }
+   temps = 0;
+   dft(n, inverse ? 1 : -1, x, X);
+   // Only once every input has been read.
+   for (k = 0; k < n; k++)
+      printf("   xr[%d] = %s;\n   xi[%d] = %s;\n", k, X[k].re, k, X[k].im);
+   printf("}\n\n");
+}
+
+/* w^(k*r) for element (k, r) of an L x R matrix, w = e^(-2 pi i / n). */
+static void table(int n, int L, int R)
+{
+   int part, k, r, e;
+   double angle;
+
+   for (part = 0; part < 2; part++)
+   {
+      printf("static const double cl_tw%d_%s[%d] =\n{", n,
+             part ? "im" : "re", n);
+      for (k = 0; k < L; k++)
+         for (r = 0; r < R; r++)
+         {
+            e = (k * r) % n;
+            angle = -2.0 * M_PI * e / n;
+            printf("%s%a,", r % 4 ? " " : "\n   ",
+                   part ? sin(angle) : cos(angle));
+         }
+      printf("\n};\n\n");
+   }
+}
+
+static void kernel(int n, int L, int R, int inverse)
+{
+   const char *d = dir_name[inverse];
+
+   printf("SIMD_TARGET\n"
+          "static void SIMD_CODELET(fft%d_%s)(const struct Complex *in,\n"
+          "                                    struct Complex *out, "
+          "double *re,\n"
+          "                                    double *im)\n"
+          "{\n"
+          "   SIMD_VEC xr[%d], xi[%d], tr, wr, wi;\n"
+          "   int r, k, j;\n\n", n, d, L > R ? L : R, L > R ? L : R);
+   printf("   for (r = 0; r < %d; r += SIMD_W)\n"
+          "   {\n"
+          "      for (k = 0; k < %d; k++)\n"
+          "         SIMD_LOAD_COMPLEX(in + %d * k + r, xr[k], xi[k]);\n"
+          "      SIMD_CODELET(dft%d_%s)(xr, xi);\n"
+          "      for (k = 1; k < %d; k++)\n"
+          "      {\n"
+          "         wr = SIMD_LOAD(cl_tw%d_re + %d * k + r);\n"
+          "         wi = SIMD_LOAD(cl_tw%d_im + %d * k + r);\n"
+          "         tr = xr[k];\n",
+          R, L, R, L, d, L, n, R, n, R);
+   if (inverse)
+      printf("         xr[k] = SIMD_FMADD(tr, wr, SIMD_MUL(xi[k], wi));\n"
+             "         xi[k] = SIMD_FMSUB(xi[k], wr, SIMD_MUL(tr, wi));\n");
+   else
+      printf("         xr[k] = SIMD_FMSUB(tr, wr, SIMD_MUL(xi[k], wi));\n"
+             "         xi[k] = SIMD_FMADD(tr, wi, SIMD_MUL(xi[k], wr));\n");
+   printf("      }\n"
+          "      for (k = 0; k < %d; k += SIMD_W)\n"
+          "      {\n"
+          "         SIMD_TRANSPOSE(xr + k);\n"
+          "         SIMD_TRANSPOSE(xi + k);\n"
+          "         for (j = 0; j < SIMD_W; j++)\n"
+          "         {\n"
+          "            SIMD_STORE(re + %d * (r + j) + k, xr[k + j]);\n"
+          "            SIMD_STORE(im + %d * (r + j) + k, xi[k + j]);\n"
+          "         }\n"
+          "      }\n"
+          "   }\n", L, L, L);
+   printf("   for (k = 0; k < %d; k += SIMD_W)\n"
+          "   {\n"
+          "      for (r = 0; r < %d; r++)\n"
+          "      {\n"
+          "         xr[r] = SIMD_LOAD(re + %d * r + k);\n"
+          "         xi[r] = SIMD_LOAD(im + %d * r + k);\n"
+          "      }\n"
+          "      SIMD_CODELET(dft%d_%s)(xr, xi);\n"
+          "      for (r = 0; r < %d; r++)\n"
+          "         SIMD_STORE_NATURAL(out + %d * r + k, xr[r], xi[r]);\n"
+          "   }\n"
+          "}\n\n", L, R, L, L, R, d, R, L);
+}
+
+int main(void)
+{
+   const int count = sizeof(sizes) / sizeof(sizes[0]);
+   int i, n, inverse;
+
+   printf("/*\n"
+          " * fft_codelets.h\n"
+          " *\n"
+          " * Written by gen_codelets; edit that instead.  Included by\n"
+          " * fft_simd_body.h, once per instruction set.\n"
+          " */\n\n");
+
+   printf("#ifndef FFT_CODELET_TABLES\n#define FFT_CODELET_TABLES\n\n");
+   for (i = 0; i < count; i++)
+      table(sizes[i][0], sizes[i][1], sizes[i][2]);
+   printf("#endif\n\n");
+
+   for (inverse = 0; inverse < 2; inverse++)
+      for (n = 8; n <= MAX_LEAF; n *= 2)
+         leaf(n, inverse);
+   for (inverse = 0; inverse < 2; inverse++)
+      for (i = 0; i < count; i++)
+         kernel(sizes[i][0], sizes[i][1], sizes[i][2], inverse);
+
+   printf("SIMD_TARGET\n"
+          "static void SIMD_CODELET(codelet)(int n, int inverse,\n"
+          "                                  const struct Complex *in,\n"
+          "                                  struct Complex *out, "
+          "double *work)\n"
+          "{\n"
+          "   switch (n)\n"
+          "   {\n");
+   for (i = 0; i < count; i++)
+      printf("   case %d:\n"
+             "      if (inverse)\n"
+             "         SIMD_CODELET(fft%d_inv)(in, out, work, work + %d);\n"
+             "      else\n"
+             "         SIMD_CODELET(fft%d_fwd)(in, out, work, work + %d);\n"
+             "      break;\n", sizes[i][0], sizes[i][0], sizes[i][0],
+             sizes[i][0], sizes[i][0]);
+   printf("   }\n}\n");
+   return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * image_fft.c
+ *
+ * Frequency-domain low-pass filter for 24-bit BMP images, done in process
+ * with the 2D FFT in fft_2d.c.
+ *
+ *   ./image_fft image.bmp [cutoff]
+ *
+ * The image is read with ImageLoad() from ../opengl/ImageReadW, and each
+ * colour channel is transformed, has every bin further than cutoff (a
+ * fraction of the Nyquist frequency, default 0.25) from DC zeroed, and is
+ * transformed back.  Writes
+ *
+ *   image_spectrum.pgm   log magnitude of the luminance spectrum, DC in
+ *                        the middle
+ *   image_filtered.ppm   the filtered image
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "fft.h"
+#include "readBMP.h"
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Zeroes every bin further than cutoff * Nyquist from DC.  Bin k stands
+   for frequency k or k - n, whichever is smaller in size. */
+static void low_pass(struct Complex *X, int nx, int ny, double cutoff)
+{
+   double fx, fy;
+   int x, y;
+
+   for (y = 0; y < ny; y++)
+   {
+      fy = (y <= ny / 2 ? y : ny - y) / (ny / 2.0);
+      for (x = 0; x < nx; x++)
+      {
+         fx = (x <= nx / 2 ? x : nx - x) / (nx / 2.0);
+         if (fx * fx + fy * fy > cutoff * cutoff)
+            X[(size_t)y * nx + x].a = X[(size_t)y * nx + x].b = 0.0;
+      }
+   }
+}
+
+/* PGM of log(1 + |X|), shifted so that DC lands in the centre. */
+static int write_spectrum(const char *name, const struct Complex *X,
+                          int nx, int ny)
+{
+   FILE *fp = fopen(name, "wb");
+   double v, peak = 0.0;
+   size_t i;
+   int x, y;
+
+   if (!fp)
+      return -1;
+   for (i = 0; i < (size_t)nx * ny; i++)
+   {
+      v = log1p(hypot(X[i].a, X[i].b));
+      if (v > peak)
+         peak = v;
+   }
+   fprintf(fp, "P5\n%d %d\n255\n", nx, ny);
+   for (y = 0; y < ny; y++)
+      for (x = 0; x < nx; x++)
+      {
+         i = (size_t)((y + ny / 2) % ny) * nx + (x + nx / 2) % nx;
+         v = log1p(hypot(X[i].a, X[i].b));
+         fputc(peak > 0 ? (int)(255.0 * v / peak) : 0, fp);
+      }
+   fclose(fp);
+   return 0;
+}
+
+/* BMP rows run bottom to top, PPM rows top to bottom. */
+static int write_ppm(const char *name, const Image *image)
+{
+   FILE *fp = fopen(name, "wb");
+   long y;
+
+   if (!fp)
+      return -1;
+   fprintf(fp, "P6\n%lu %lu\n255\n", image->sizeX, image->sizeY);
+   for (y = image->sizeY - 1; y >= 0; y--)
+      fwrite(image->data + y * image->sizeX * 3, 3, image->sizeX, fp);
+   fclose(fp);
+   return 0;
+}
+
+int main(int argc, char **argv)
+{
+   Image image;
+   fft_2d_plan *plan;
+   struct Complex *plane, *work;
+   double cutoff = 0.25, t;
+   int nx, ny, c;
+
+   if (argc < 2)
+   {
+      printf("usage: %s image.bmp [cutoff]\n", argv[0]);
+      return 1;
+   }
+   if (argc > 2)
+      cutoff = atof(argv[2]);
+   if (!ImageLoad(argv[1], &image))
+      return 1;
+
+   nx = image.sizeX;
+   ny = image.sizeY;
+   plan = fft_2d_plan_create(nx, ny, 0);
+   plane = plan ? malloc((size_t)nx * ny * sizeof(*plane)) : NULL;
+   work = plan ? malloc((size_t)fft_2d_work_size(plan) * sizeof(*work)) : NULL;
+   if (!plan || !plane || !work)
+   {
+      printf("Image too big or out of memory\n");
+      return 1;
+   }
+   printf("Transform size %d x %d\n", nx, ny);
+
+   fft_2d_load_pixels(plan, image.data, image.sizeX, image.sizeY,
+                      FFT_2D_GRAY, plane);
+   t = now();
+   fft_2d_execute_work(plan, plane, plane, 0, work);
+   printf("Forward 2D FFT took %.3fms\n", (now() - t) * 1e3);
+   write_spectrum("image_spectrum.pgm", plane, nx, ny);
+
+   for (c = 0; c < 3; c++)
+   {
+      fft_2d_load_pixels(plan, image.data, image.sizeX, image.sizeY, c,
+                         plane);
+      fft_2d_execute_work(plan, plane, plane, 0, work);
+      low_pass(plane, nx, ny, cutoff);
+      fft_2d_execute_work(plan, plane, plane, 1, work);
+      fft_2d_store_pixels(plan, plane, 1.0 / ((double)nx * ny), image.data,
+                          image.sizeX, image.sizeY, c);
+   }
+   write_ppm("image_filtered.ppm", &image);
+   printf("Wrote image_spectrum.pgm and image_filtered.ppm\n");
+
+   fft_2d_plan_destroy(plan);
+   free(plane);
+   free(work);
+   free(image.data);
+   return 0;
+}
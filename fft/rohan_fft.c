@@ -1,149 +1,730 @@
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <math.h>
 #include <string.h>
+#include "fft.h"
+#include "adc_capture.h"
+#include "adc_text.h"
+#include "spectrum_writer.h"
+#include "frame_pipeline.h"
 
+#define N_POINTS 1024
+#define N_BINS (N_POINTS / 2 + 1)   // the other bins mirror these
 
-struct Complex
-{ double a; //Real Part
-   double b; //Imaginary Part
-} X[1024], U, W, T, Tmp;
+#define CHUNK 4096   // samples per step in spectrogram mode
 
-void FFT(void)
+#define VOLTS (3.3 / 4095)   // per count of the 12-bit ADC
+
+#define WISDOM_FILE "rohan_wisdom"   // kernel timings kept between runs
+
+/* Output options, given before the mode: -Q, -S sections, -B and
+   -W window. */
+static int out_echo = 1;           // copy the output to the terminal
+static int out_sections = 0;       // SPW_*, 0 for the mode's default
+static int out_format = SPW_TEXT;
+static int out_window = FFT_WINDOW_RECT;   // -1 for a name not known
+static double out_beta = 0.0;      // Kaiser beta, 0 for the default
+
+/* Names of FFT_WINDOW_*, in order. */
+static const char *windows[] =
+{
+   "rect", "hann", "hamming", "blackman", "blackman-harris", "flattop",
+   "kaiser"
+};
+
+/* FFT_WINDOW_* for name, "kaiser:beta" setting *beta, or -1. */
+static int window_named(const char *name, double *beta)
 {
-   int M = 10;
-   int N = pow(2, M);
-   int i = 1, j = 1, k = 1;
-   int LE = 0, LE1 = 0;
+   size_t len = strcspn(name, ":");
+   int i;
 
-   int IP = 0;
-   for (k = 1; k <= M; k++)
+   *beta = 0.0;
+   for (i = FFT_WINDOW_KAISER; i >= FFT_WINDOW_RECT; i--)
+      if (strlen(windows[i]) == len && strncmp(name, windows[i], len) == 0)
+         break;
+   if (name[len] == ':')
    {
-      LE = pow(2, M + 1 - k);
-      LE1 = LE / 2;
-      U.a = 1.0;
-      U.b = 0.0;
-      W.a = cos(M_PI / (double)LE1);
-      W.b = -sin(M_PI/ (double)LE1);
-      for (j = 1; j <= LE1; j++)
-      {
-         for (i = j; i <= N; i = i + LE)
-         {
-            IP = i + LE1;
-            T.a = X[i].a + X[IP].a;
-            T.b = X[i].b + X[IP].b;
-            Tmp.a = X[i].a - X[IP].a;
-            Tmp.b = X[i].b - X[IP].b;
-            X[IP].a = (Tmp.a * U.a) - (Tmp.b * U.b);
-            X[IP].b = (Tmp.a * U.b) + (Tmp.b * U.a);
-            X[i].a = T.a;
-            X[i].b = T.b;
-         }
-         Tmp.a = (U.a * W.a) - (U.b * W.b);
-         Tmp.b = (U.a * W.b) + (U.b * W.a);
-         U.a = Tmp.a;
-         U.b = Tmp.b;
-      }
+      if (i != FFT_WINDOW_KAISER)
+         return -1;
+      *beta = atof(name + len + 1);
    }
+   return i;
+}
+
+/* Lists the window names after a bad one. */
+static int bad_window(void)
+{
+   int i;
+
+   printf("Windows are");
+   for (i = FFT_WINDOW_RECT; i <= FFT_WINDOW_KAISER; i++)
+      printf(" %s", windows[i]);
+   printf(" and kaiser:beta\n");
+   return 1;
+}
 
-   int NV2 = N / 2;
-   int NM1 = N - 1;
-   int K = 0;
-   j = 1;
-   for (i = 1; i <= NM1; i++)
-   {
-      if (i >= j) goto TAG25;
-      T.a = X[j].a;
-      T.b = X[j].b;
-      X[j].a = X[i].a;
-      X[j].b = X[i].b;
-      X[i].a = T.a;
-      X[i].b = T.b;
-TAG25: K = NV2;
-TAG26: if (K >= j) goto TAG30;
-       j = j - K;
-       K = K / 2;
-       goto TAG26;
-TAG30: j = j + K;
+/* Reads the text capture at name into t, saying so if it cannot or if some
+   of its lines were not numbers. */
+static int read_text(const char *name, double scale, struct adc_text *t)
+{
+   if (adc_text_read(name, scale, t) < 0)
+   {
+      printf("Not Opened\n");
+      return -1;
    }
+   if (t->bad_lines > 0)
+      printf("%s: %lld malformed lines skipped, the first is line %lld\n",
+             name, (long long)t->bad_lines, (long long)t->first_bad);
+   return 0;
 }
 
+/* Header of the spectrogram file, followed by frames * bins float32
+   magnitudes, frame after frame.  All fields are in the machine's byte
+   order; frames is filled in once the input has been read. */
+struct spectrogram_header
+{
+   char magic[4];      // "STFT"
+   int32_t version;    // 1
+   int32_t n;          // samples per frame
+   int32_t hop;        // samples between frame starts
+   int32_t window;     // FFT_WINDOW_*
+   int32_t bins;       // n/2 + 1
+   int32_t frames;
+};
 
-int main(void)
+/* ./out_rohan_fft -s n hop [window [input [output]]]
+   Slides an n-point window along the whole input file, hop samples at a
+   time, and writes the magnitude of every frame to the output file. */
+static int spectrogram(int argc, char **argv)
 {
-   unsigned int i;
-   float pm[1024];
-   int arr[1024];
-   float fm,c, d;
+   struct spectrogram_header hdr;
+   const char *in_name = argc > 5 ? argv[5] : "rohan_data.txt";
+   const char *out_name = argc > 6 ? argv[6] : "rohan_spectrogram.bin";
+   struct adc_text text;
+   float *mag;
+   fft_stft *stft;
+   FILE *op;
+   int64_t at;
+   int window = FFT_WINDOW_HANN, count, frames, total = 0;
+   double beta;
+
+   if (argc > 4 && (window = window_named(argv[4], &beta)) < 0)
+      return bad_window();
+   if (read_text(in_name, VOLTS, &text) < 0)
+      return 1;
+   stft = fft_stft_create(atoi(argv[2]), atoi(argv[3]), window);
+   if (!stft)
+   {
+      printf("n must be even and hop at least 1\n");
+      adc_text_free(&text);
+      return 1;
+   }
+   // Enough for any chunk: once the first frame is out a new one is due
+   // every hop samples, and one may be due on the chunk's first sample.
+   mag = malloc((size_t)((CHUNK - 1) / atoi(argv[3]) + 1) *
+                fft_stft_bins(stft) * sizeof(*mag));
+   if (!mag)
+   {
+      printf("Out of memory\n");
+      fft_stft_destroy(stft);
+      adc_text_free(&text);
+      return 1;
+   }
+   op = fopen(out_name, "wb");
+   if (!op)
+   {
+      printf("Could not create %s\n", out_name);
+      free(mag);
+      fft_stft_destroy(stft);
+      adc_text_free(&text);
+      return 1;
+   }
+
+   memcpy(hdr.magic, "STFT", 4);
+   hdr.version = 1;
+   hdr.n = atoi(argv[2]);
+   hdr.hop = atoi(argv[3]);
+   hdr.window = window;
+   hdr.bins = fft_stft_bins(stft);
+   hdr.frames = 0;
+   fwrite(&hdr, sizeof(hdr), 1, op);
+
+   for (at = 0; at < text.count; at += count)
+   {
+      count = text.count - at < CHUNK ? text.count - at : CHUNK;
+      frames = fft_stft_process(stft, text.samples + at, count, mag);
+      fwrite(mag, sizeof(*mag) * hdr.bins, frames, op);
+      total += frames;
+   }
+
+   hdr.frames = total;
+   fseek(op, 0, SEEK_SET);
+   fwrite(&hdr, sizeof(hdr), 1, op);
+   printf("%d frames of %d bins (%s window) written to %s\n", total,
+          hdr.bins, windows[window], out_name);
+   fclose(op);
+   adc_text_free(&text);
+   free(mag);
+   fft_stft_destroy(stft);
+   return 0;
+}
+
+/* ./out_rohan_fft -q [input]
+   Transforms the first N_POINTS raw 12-bit counts with the Q15 and Q31
+   fixed-point FFTs, as firmware would, and prints the SNR of each against
+   the double-precision transform of the same counts. */
+static int fixed_point(int argc, char **argv)
+{
+   static struct ComplexQ15 x15[N_POINTS];
+   static struct ComplexQ31 x31[N_POINTS];
+   static struct Complex ref[N_POINTS];
+   const char *in_name = argc > 2 ? argv[2] : "rohan_data.txt";
+   fft_fixed_plan *fplan;
+   fft_plan *plan;
+   double sig2 = 0.0, err15 = 0.0, err31 = 0.0, d, c;
+   struct adc_text text;
+   int i, e15, e31;
+
+   if (read_text(in_name, 1.0, &text) < 0)
+      return 1;
+   for (i = 0; i < N_POINTS && i < text.count; i++)
+   {
+      // Counts go in as they are; only the clamp a 12-bit ADC implies.
+      c = text.samples[i];
+      x15[i].a = c < 0 ? 0 : c > 4095 ? 4095 : (int16_t)c;
+      x15[i].b = 0;
+   }
+   for (; i < N_POINTS; i++)
+      x15[i].a = x15[i].b = 0;
+   adc_text_free(&text);
+   for (i = 0; i < N_POINTS; i++)
+   {
+      x31[i].a = x15[i].a;
+      x31[i].b = 0;
+      ref[i].a = x15[i].a;
+      ref[i].b = 0.0;
+   }
+
+   fplan = fft_fixed_plan_create(N_POINTS, 0);
+   plan = fft_plan_create(N_POINTS, FFT_SIMD);
+   if (!fplan || !plan)
+   {
+      printf("Out of memory\n");
+      return 1;
+   }
+   fft_execute(plan, ref, ref);
+   e15 = fft_execute_q15(fplan, x15, x15);
+   e31 = fft_execute_q31(fplan, x31, x31);
+   fft_plan_destroy(plan);
+   fft_fixed_plan_destroy(fplan);
+
+   for (i = 0; i < N_POINTS; i++)
+   {
+      sig2 += ref[i].a * ref[i].a + ref[i].b * ref[i].b;
+      d = hypot(ldexp(x15[i].a, e15) - ref[i].a,
+                ldexp(x15[i].b, e15) - ref[i].b);
+      err15 += d * d;
+      d = hypot(ldexp(x31[i].a, e31) - ref[i].a,
+                ldexp(x31[i].b, e31) - ref[i].b);
+      err31 += d * d;
+   }
+   printf("%d counts, %d bytes a frame in Q15 against %d in double\n",
+          N_POINTS, (int)sizeof(x15), (int)sizeof(ref));
+   printf("Q15: block exponent %d, SNR %.1f dB\n", e15,
+          10.0 * log10(sig2 / err15));
+   printf("Q31: block exponent %d, SNR %.1f dB\n", e31,
+          err31 > 0 ? 10.0 * log10(sig2 / err31) : INFINITY);
+   printf("DC bin %.1f counts in double, %d * 2^%d in Q15\n",
+          ref[0].a, x15[0].a, e15);
+   return 0;
+}
+
+/* ./out_rohan_fft -g bin [bin ...]
+   Monitors just the given bins: every N_POINTS samples of the data file
+   make one frame, and the power of each bin (scaled like the full
+   spectrum's) is printed per frame.  A few bins go through Goertzel
+   filters, enough of them through the FFT. */
+static int monitor_bins(int argc, char **argv)
+{
+   int bins[N_BINS];
+   struct Complex X[N_BINS];
+   double x[N_POINTS];
+   struct adc_text text;
+   fft_goertzel *g;
+   int64_t at;
+   int nbins = argc - 2, i, count, frame = 0;
+
+   if (nbins > N_BINS)
+      nbins = N_BINS;
+   for (i = 0; i < nbins; i++)
+      bins[i] = atoi(argv[i + 2]);
+   g = fft_goertzel_create(N_POINTS, bins, nbins, FFT_GOERTZEL_AUTO);
+   if (!g)
+   {
+      printf("bins must be from 0 to %d\n", N_POINTS / 2);
+      return 1;
+   }
+   if (read_text("rohan_data.txt", VOLTS, &text) < 0)
+      return 1;
+   printf("%d bins by %s\n", nbins,
+          fft_goertzel_uses_fft(g) ? "FFT" : "Goertzel filters");
+   for (at = 0; at < text.count; at += N_POINTS)
+   {
+      count = text.count - at < N_POINTS ? text.count - at : N_POINTS;
+      memcpy(x, text.samples + at, count * sizeof(*x));
+      for (i = count; i < N_POINTS; i++)
+         x[i] = 0.0;
+      fft_goertzel_process(g, x, X);
+      printf("frame %d:", frame++);
+      for (i = 0; i < nbins; i++)
+         printf(" pm[%d] = %f", bins[i], hypot(X[i].a, X[i].b) / 1024);
+      printf("\n");
+   }
+   adc_text_free(&text);
+   fft_goertzel_destroy(g);
+   return 0;
+}
+
+/* ./out_rohan_fft -l bin [bin ...]
+   Live version of -g: the given bins of the last N_POINTS samples are
+   updated as each sample of the data file comes in, and printed for every
+   sample from the first full window on. */
+static int live_bins(int argc, char **argv)
+{
+   int bins[N_BINS];
+   struct Complex X[N_BINS];
+   struct adc_text text;
+   fft_sdft *s;
+   int64_t t;
+   int nbins = argc - 2, i;
+
+   if (nbins > N_BINS)
+      nbins = N_BINS;
+   for (i = 0; i < nbins; i++)
+      bins[i] = atoi(argv[i + 2]);
+   s = fft_sdft_create(N_POINTS, bins, nbins, 0);
+   if (!s)
+   {
+      printf("bins must be from 0 to %d\n", N_POINTS / 2);
+      return 1;
+   }
+   if (read_text("rohan_data.txt", VOLTS, &text) < 0)
+      return 1;
+   for (t = 0; t < text.count; t++)
+   {
+      fft_sdft_process(s, text.samples + t, 1);
+      if (t < N_POINTS - 1)
+         continue;
+      fft_sdft_spectrum(s, X);
+      printf("sample %lld:", (long long)t);
+      for (i = 0; i < nbins; i++)
+         printf(" pm[%d] = %f", bins[i], hypot(X[i].a, X[i].b) / 1024);
+      printf("\n");
+   }
+   adc_text_free(&text);
+   fft_sdft_destroy(s);
+   return 0;
+}
+
+/* ./out_rohan_fft -c [input.txt [output.bin [int16|int32|float64 [rate
+                                                               [channels]]]]]
+   Converts a text capture to the binary format of adc_capture.h, float64
+   volts unless asked otherwise, so that -b and -m can map it. */
+static int convert_capture(int argc, char **argv)
+{
+   static const char *formats[] = { "", "int16", "int32", "float64" };
+   const char *in_name = argc > 2 ? argv[2] : "rohan_data.txt";
+   const char *out_name = argc > 3 ? argv[3] : "rohan_data.bin";
+   int format = ADC_FLOAT64;
+   int64_t count;
+
+   if (argc > 4)
+      for (format = ADC_FLOAT64; format > ADC_INT16; format--)
+         if (strcmp(argv[4], formats[format]) == 0)
+            break;
+   count = adc_capture_from_text(in_name, out_name, format,
+                                 argc > 5 ? atoi(argv[5]) : 0, 12, 3.3,
+                                 argc > 6 ? atoi(argv[6]) : 1);
+   if (count < 0)
+   {
+      printf("Could not convert %s to %s\n", in_name, out_name);
+      return 1;
+   }
+   printf("%lld frames written to %s as %s\n", (long long)count, out_name,
+          formats[format]);
+   return 0;
+}
+
+/* What the -b pipeline callbacks share. */
+struct capture_run
+{
+   adc_capture *cap;
+   const double *volts;      // the mapped samples, or NULL
+   int64_t samples;          // per channel
+   int channel;
+   spectrum_writer *w;
+   int64_t valid;
+};
+
+/* Frame k of the capture, zero padded at the end; NULL after the last. */
+static const double *capture_frame(void *arg, int64_t k, double *buf)
+{
+   struct capture_run *run = arg;
+   int64_t got;
+   int i;
+
+   if (k * N_POINTS >= run->samples)
+      return NULL;
+   if (run->volts && (k + 1) * N_POINTS <= run->samples)
+      return run->volts + k * N_POINTS;
+   got = adc_capture_read(run->cap, run->channel, k * N_POINTS, N_POINTS,
+                          buf);
+   for (i = got < 0 ? 0 : got; i < N_POINTS; i++)
+      buf[i] = 0.0;
+   return buf;
+}
+
+static void capture_verdict(void *arg, const struct pipeline_frame *f)
+{
+   struct capture_run *run = arg;
    float max = 0.0;
+   int i;
 
-   FILE *ip;
-   FILE *fp;
-   fp = fopen("rohan_pwm","w");
-   ip = fopen("rohan_data.txt","r");
-   if(!ip)
-      printf("Not Opened");
-   i=0;
-   while(!feof(ip) || i<1024)
+   for (i = 0; i < N_BINS; i++)
+      if (max < f->power[i])
+         max = f->power[i];
+   spw_input(run->w, f->x, N_POINTS);
+   spw_bins(run->w, f->X, N_BINS, 1.0 / 256);
+   spw_power(run->w, f->power, N_BINS);
+   spw_verdict(run->w, f->index, 511, f->power[511],
+               f->power[511] <= max * 0.05);
+   if (f->power[511] <= max * 0.05)
+      run->valid++;
+}
+
+/* ./out_rohan_fft -b [capture.bin [channel [workers]]]
+   Runs the validity check on every N_POINTS-sample frame of a binary
+   capture, the last one zero padded and each one windowed as -W says.  A
+   single-channel float64 capture is transformed straight from the mapped
+   file.  Reading, the FFTs and the output run on separate threads
+   (workers FFT threads, by default one per spare CPU), the output still
+   in frame order.  Only the verdicts are written unless -S asks for more,
+   and to the terminal only unless -B asks for rohan_pwm.bin. */
+static int binary_capture(int argc, char **argv)
+{
+   const char *in_name = argc > 2 ? argv[2] : "rohan_data.bin";
+   int workers = argc > 4 ? atoi(argv[4]) : 0;
+   const struct fft_window *win;
+   const struct adc_capture_info *info;
+   struct capture_run run = { 0 };
+   fft_real_plan *plan;
+   int64_t frames;
+
+   run.channel = argc > 3 ? atoi(argv[3]) : 0;
+   run.cap = adc_capture_open(in_name);
+   if (!run.cap)
+   {
+      printf("Not Opened\n");
+      return 1;
+   }
+   info = adc_capture_info(run.cap);
+   if (run.channel < 0 || run.channel >= info->channels)
    {
+      printf("Channel must be from 0 to %d\n", info->channels - 1);
+      adc_capture_close(run.cap);
+      return 1;
+   }
+   run.volts = adc_capture_volts(run.cap);
+   run.samples = info->frames;
 
-      fscanf(ip, "%f", &fm);// reading from the file.
+   // Timed here once, so the pipeline's plan comes from the wisdom.
+   fft_wisdom_load(WISDOM_FILE);
+   plan = fft_real_plan_create(N_POINTS, FFT_MEASURE);
+   fft_wisdom_save(WISDOM_FILE);
+   fft_real_plan_destroy(plan);
+   run.w = spw_open(out_format == SPW_BINARY ? "rohan_pwm.bin" : NULL,
+                    out_format, out_sections ? out_sections : SPW_VERDICT,
+                    out_echo);
+   if (!run.w)
+   {
+      printf("Out of memory\n");
+      adc_capture_close(run.cap);
+      return 1;
+   }
+   printf("%s: %d Hz, %d bits, %d channels, %lld frames%s\n", in_name,
+          (int)info->sample_rate, info->bits, info->channels,
+          (long long)info->frames, run.volts ? ", mapped straight into the FFT"
+                                             : "");
+
+   win = fft_window_get(out_window, N_POINTS, out_beta);
+   frames = -1;
+   if (win)
+      frames = frame_pipeline_run(N_POINTS, FFT_MEASURE, win, workers, 0,
+                                  capture_frame, capture_verdict, &run);
+   if (spw_close(run.w) < 0)
+      printf("Could not write rohan_pwm.bin\n");
+   if (frames < 0)
+   {
+      printf("Out of memory\n");
+      adc_capture_close(run.cap);
+      return 1;
+   }
+   printf("%lld of %lld frames valid\n", (long long)run.valid,
+          (long long)frames);
+   adc_capture_close(run.cap);
+   return 0;
+}
+
+/* ./out_rohan_fft -m capture.bin
+   ./out_rohan_fft -m channels [input.txt]
+   The validity check on every channel of a multi-channel capture, a binary
+   one with the channel count in its header or a text one with channels
+   numbers per frame.  Each N_POINTS-frame block is de-interleaved in one
+   pass and its channels are transformed in parallel, one per CPU. */
+static int multi_channel(int argc, char **argv)
+{
+   char *end;
+   // A channel count only if the whole argument is a number, so that a
+   // capture called "4ch.bin" is still taken for a file.
+   const long count = strtol(argv[2], &end, 10);
+   const int text_in = *argv[2] != '\0' && *end == '\0';
+   const char *in_name = text_in ? (argc > 3 ? argv[3] : "rohan_data.txt")
+                                 : argv[2];
+   struct adc_text text = { 0 };
+   adc_capture *cap = NULL;
+   const double *mapped = NULL, *x;
+   struct Complex *X;
+   fft_multi_plan *plan;
+   double *buf;
+   float *pm, max;
+   int64_t frame, frames, got, *valid;
+   int channels, c, i, ok;
+
+   if (text_in)
+   {
+      if (count < 1 || count > INT_MAX)
+      {
+         printf("The channel count must be at least 1\n");
+         return 1;
+      }
+      channels = (int)count;
+      if (read_text(in_name, VOLTS, &text) < 0)
+         return 1;
+      frames = (text.count / channels + N_POINTS - 1) / N_POINTS;
+   }
+   else
+   {
+      cap = adc_capture_open(in_name);
+      if (!cap)
       {
-         arr[i]= fm * 3.3/4095;
-         i++;
+         printf("Not Opened\n");
+         return 1;
       }
+      channels = adc_capture_info(cap)->channels;
+      frames = (adc_capture_info(cap)->frames + N_POINTS - 1) / N_POINTS;
+      mapped = adc_capture_frames(cap);
    }
 
-   //float arr[5] = {0.0, 2.0, 3.0, 4.0, 4.0};
-   for (i = 0; i < 1024; i++)
+   fft_wisdom_load(WISDOM_FILE);
+   plan = fft_multi_plan_create(N_POINTS, channels, FFT_MEASURE, 0);
+   fft_wisdom_save(WISDOM_FILE);
+   buf = malloc((size_t)N_POINTS * channels * sizeof(*buf));
+   X = malloc((size_t)N_BINS * channels * sizeof(*X));
+   pm = malloc((size_t)N_BINS * channels * sizeof(*pm));
+   valid = calloc(channels, sizeof(*valid));
+   if (!plan || !buf || !X || !pm || !valid)
    {
-      X[i].a = arr[i];
-      X[i].b = 0.0;
+      printf("Out of memory\n");
+      return 1;
    }
+   printf("%s: %d channels, %lld frames of %d samples\n", in_name, channels,
+          (long long)frames, N_POINTS);
 
-   printf ("*********Before*********\n");
-   fprintf (fp, "*********Before*********\n");
-   for (i = 0; i < 1024; i++)
+   for (frame = 0; frame < frames; frame++)
    {
-      printf ("X[%d]:real == %f imaginary == %f\n", i, X[i].a, X[i].b);
-      fprintf (fp, "X[%d]:real == %f imaginary == %f\n", i, X[i].a, X[i].b);
+      // The block of all channels, straight from the file when possible,
+      // with the last one zero padded.
+      if (text_in)
+      {
+         x = text.samples + frame * N_POINTS * channels;
+         got = (text.count - frame * N_POINTS * channels) / channels;
+      }
+      else
+      {
+         x = mapped ? mapped + frame * N_POINTS * channels : NULL;
+         got = adc_capture_info(cap)->frames - frame * N_POINTS;
+      }
+      if (got < N_POINTS || !x)
+      {
+         if (cap)
+            got = adc_capture_read_frames(cap, frame * N_POINTS, N_POINTS,
+                                          buf);
+         else
+            memcpy(buf, x, got * channels * sizeof(*buf));
+         for (i = got * channels; i < N_POINTS * channels; i++)
+            buf[i] = 0.0;
+         x = buf;
+      }
+      fft_multi_execute(plan, x, X, pm);
+
+      if (out_echo)
+         printf("frame %lld:", (long long)frame);
+      for (c = 0; c < channels; c++)
+      {
+         max = 0.0;
+         for (i = 0; i < N_BINS; i++)
+            if (max < pm[c * N_BINS + i])
+               max = pm[c * N_BINS + i];
+         ok = pm[c * N_BINS + 511] <= max * 0.05;
+         valid[c] += ok;
+         if (out_echo)
+            printf(" %d %s", c, ok ? "valid" : "invalid");
+      }
+      if (out_echo)
+         printf("\n");
+   }
+   for (c = 0; c < channels; c++)
+      printf("channel %d: %lld of %lld frames valid\n", c,
+             (long long)valid[c], (long long)frames);
+
+   fft_multi_plan_destroy(plan);
+   adc_capture_close(cap);
+   adc_text_free(&text);
+   free(buf);
+   free(X);
+   free(pm);
+   free(valid);
+   return 0;
+}
+
+/* Takes the output options off the front of the arguments, leaving the
+   program name in argv[0] for the mode parsing. */
+static int output_options(int argc, char **argv)
+{
+   const char *p;
+   int i;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "-Q") == 0)
+         out_echo = 0;
+      else if (strcmp(argv[i], "-B") == 0)
+         out_format = SPW_BINARY;
+      else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc)
+         out_window = window_named(argv[++i], &out_beta);
+      else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+      {
+         for (p = argv[++i]; *p; p++)
+            out_sections |= *p == 'i' ? SPW_INPUT : *p == 'b' ? SPW_BINS :
+                            *p == 'p' ? SPW_POWER :
+                            *p == 'v' ? SPW_VERDICT : 0;
+      }
+      else
+         break;
    }
-   FFT();
+   argv[i - 1] = argv[0];
+   return i - 1;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned int i;
+   float pm[N_BINS];
+   double x[N_POINTS];
+   struct Complex X[N_BINS];
+   float c, d;
+   float max = 0.0;
+   struct adc_text text;
+   const struct fft_window *win;
+   struct Complex *work;
+   fft_real_plan *plan;
+   spectrum_writer *w;
+   int skip;
+
+   skip = output_options(argc, argv);
+   argc -= skip;
+   argv += skip;
+   if (out_window < 0)
+      return bad_window();
+   if (argc > 3 && strcmp(argv[1], "-s") == 0)
+      return spectrogram(argc, argv);
+   if (argc > 1 && strcmp(argv[1], "-q") == 0)
+      return fixed_point(argc, argv);
+   if (argc > 2 && strcmp(argv[1], "-g") == 0)
+      return monitor_bins(argc, argv);
+   if (argc > 1 && strcmp(argv[1], "-c") == 0)
+      return convert_capture(argc, argv);
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      return binary_capture(argc, argv);
+   if (argc > 2 && strcmp(argv[1], "-l") == 0)
+      return live_bins(argc, argv);
+   if (argc > 2 && strcmp(argv[1], "-m") == 0)
+      return multi_channel(argc, argv);
+
+   // A window other than rect keeps the leakage of strong bins out of
+   // bin 511.  Its coherent gain is divided out of the power so that a
+   // tone reads the same amplitude whatever the window.
+   win = fft_window_get(out_window, N_POINTS, out_beta);
+   if (!win)
+      return bad_window();
+   if (out_window != FFT_WINDOW_RECT && out_echo)
+      printf("%s window: coherent gain %.4f, noise bandwidth %.3f bins\n",
+             windows[out_window], win->coherent_gain, win->enbw);
+
+   // The first N_POINTS samples in volts, zero padded if there are fewer.
+   if (read_text("rohan_data.txt", VOLTS, &text) < 0)
+      return 1;
+   for (i = 0; i < N_POINTS; i++)
+      x[i] = i < text.count ? text.samples[i] : 0.0;
+   adc_text_free(&text);
 
-   printf ("\n\n**********After*********\n");
-   fprintf (fp, "\n\n**********After*********\n");
-   for (i = 0; i < 1024; i++)
+   // Everything is formatted once and written in large blocks, to the
+   // terminal as well unless -Q was given.
+   w = spw_open(out_format == SPW_BINARY ? "rohan_pwm.bin" : "rohan_pwm",
+                out_format, out_sections ? out_sections : SPW_ALL, out_echo);
+   if (!w)
    {
-      printf ("X[%d]:real == %f imaginary == %f\n", i, (X[i].a/256), (X[i].b/256));
-      fprintf (fp, "X[%d]:real == %f imaginary == %f\n", i, (X[i].a/256), (X[i].b/256));
+      printf("Not Opened");
+      return 1;
+   }
+   spw_input(w, x, N_POINTS);
+
+   // The samples are real, so only bins 0..N/2 are worth computing.  The
+   // kernel is the fastest one on this machine, timed on the first run
+   // and read back from the wisdom file after that.  The window is
+   // applied as the FFT packs its input, not in a pass of its own.
+   fft_wisdom_load(WISDOM_FILE);
+   plan = fft_real_plan_create(N_POINTS, FFT_MEASURE);
+   fft_wisdom_save(WISDOM_FILE);
+   work = plan ? malloc(fft_real_work_size(plan) * sizeof(*work)) : NULL;
+   if (!work)
+   {
+      printf("Out of memory\n");
+      return 1;
    }
-   printf("\n\n************ Calculate Power ********\n\n");
-   fprintf(fp, "\n\n************ Calculate Power ********\n\n");
+   fft_execute_r2c_window_work(plan, x, win->w, X, work);
+   free(work);
+   fft_real_plan_destroy(plan);
+   spw_bins(w, X, N_BINS, 1.0 / 256);
 
-   for (i = 0; i < 1024; i++)
+   for (i = 0; i < N_BINS; i++)
    {
 
       c= pow((X[i].a/1024),2);
       d= pow((X[i].b/1024),2);
-      pm[i]= sqrt((c+d));
-      fprintf(fp, "Power is %f\n", pm[i]); //writing into the file.
-      printf("Power is %f\n", pm[i]);
+      pm[i]= sqrt((c+d)) / win->coherent_gain;
       if(max<pm[i])
          max = pm[i];
    }
-
-   printf("power at N = 511 is %f\n", pm[511]);
-   if(pm[511]<=(max*0.05))
-   {
-      printf("data is valid\n");
-      fprintf(fp, "data is valid\n");
-   }
-   else
+   spw_power(w, pm, N_BINS);
+   spw_verdict(w, -1, 511, pm[511], pm[511]<=(max*0.05));
+   if (spw_close(w) < 0)
    {
-      printf("Data invalid\n");
-      fprintf(fp, "Data invalid\n");
+      printf("Could not write the output\n");
+      return 1;
    }
-   fclose(fp);
-   fclose(ip);
    return 0;
 }
@@ -0,0 +1,409 @@
+/*
+ * spectrum_writer.c
+ *
+ * Everything goes through two buffers of BUF_SIZE bytes, one for text and
+ * one for binary records, which are only handed to stdio when full or at
+ * the end.  The text is formatted once however many places it goes to,
+ * and only when some place wants it.  Numbers are put together digit by
+ * digit by spw_format(), which only falls back on snprintf() for the ones
+ * that need 16 or 17 digits or lie beyond 10^+-22.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "spectrum_writer.h"
+
+#define BUF_SIZE (1 << 16)
+#define MAX_LINE 128   // longest line or record written in one go
+
+struct spectrum_writer
+{
+   int format, sections, echo;
+   int want_text;              // some destination takes text
+   FILE *fp;                   // NULL for no file
+   int err;
+   char *text;
+   size_t text_len;
+   unsigned char *bin;
+   size_t bin_len;
+};
+
+
+/* Non-negative integer i at p, returning the length. */
+static int put_int(char *p, long long i)
+{
+   char digits[24];
+   int n = 0, len;
+
+   do
+   {
+      digits[n++] = '0' + i % 10;
+      i /= 10;
+   } while (i > 0);
+   for (len = 0; n > 0; len++)
+      p[len] = digits[--n];
+   return len;
+}
+
+/* Powers of ten, all exact in a double. */
+static const double pow10[] =
+{
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+   1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* m * 10^k, correctly rounded: both are exact in a double, so the one
+   multiply or divide rounds once. */
+static double scale10(double m, int k)
+{
+   return k >= 0 ? m * pow10[k] : m / pow10[-k];
+}
+
+/* Writes m * 10^k, m > 0, the way %g would with just the digits m has. */
+static int put_decimal(char *buf, long long m, int k)
+{
+   char digits[24];
+   int len, x, i, n = 0;
+
+   while (m % 10 == 0)
+   {
+      m /= 10;
+      k++;
+   }
+   len = put_int(digits, m);
+   x = k + len - 1;   // exponent of the first digit
+   if (x < -4 || x >= len)
+   {
+      // d.ddde+xx
+      buf[n++] = digits[0];
+      if (len > 1)
+      {
+         buf[n++] = '.';
+         memcpy(buf + n, digits + 1, len - 1);
+         n += len - 1;
+      }
+      buf[n++] = 'e';
+      buf[n++] = x < 0 ? '-' : '+';
+      if (x < 0)
+         x = -x;
+      if (x < 10)
+         buf[n++] = '0';
+      return n + put_int(buf + n, x);
+   }
+   if (x < 0)
+   {
+      // 0.000ddd
+      buf[n++] = '0';
+      buf[n++] = '.';
+      for (i = -1; i > x; i--)
+         buf[n++] = '0';
+      memcpy(buf + n, digits, len);
+      return n + len;
+   }
+   // ddd.ddd
+   memcpy(buf, digits, x + 1);
+   n = x + 1;
+   buf[n++] = '.';
+   memcpy(buf + n, digits + x + 1, len - x - 1);
+   return n + len - x - 1;
+}
+
+int spw_format(char *buf, double v, int single)
+{
+   double a, lo = 0.0, hi = 0.0, d;
+   long long m;
+   int e, p, k, n = 0;
+
+   if (!isfinite(v))
+      return sprintf(buf, "%g", v);
+   if (single)
+      v = (float)v;
+   if (v < 0 || (v == 0 && signbit(v)))
+      buf[n++] = '-';
+   a = fabs(v);
+   // Whole numbers, the input samples among them, are written as they are.
+   if (a < 1e15 && a == (long long)a)
+      return n + put_int(buf + n, (long long)a);
+   if (single)
+   {
+      // Anything strictly between the midpoints to the neighbouring floats
+      // reads back as this float.
+      lo = (a + nextafterf(a, 0.0f)) / 2;
+      hi = (a + nextafterf(a, INFINITY)) / 2;
+   }
+
+   // Tries 1, 2, ... significant digits: m is the nearest p-digit number
+   // and m * 10^k the decimal it stands for.  Up to 15 digits and 10^22 m
+   // is exact and so is the test; the rest are left to the C library.
+   e = (int)floor(log10(a));
+   for (p = 1; p <= (single ? 9 : 15); p++)
+   {
+      k = e - p + 1;
+      if (k < -22 || k > 22)
+         break;
+      m = (long long)nearbyint(scale10(a, -k));
+      if (m == 0)
+         continue;
+      d = scale10((double)m, k);
+      if (single ? lo < d && d < hi : d == a)
+         return n + put_decimal(buf + n, m, k);
+   }
+   for (; ; p++)
+   {
+      k = snprintf(buf, 32, "%.*g", p, v);
+      if (p == (single ? 9 : 17) ||
+          (single ? strtof(buf, NULL) == (float)v : strtod(buf, NULL) == v))
+         return k;
+   }
+}
+
+static void flush_text(spectrum_writer *w)
+{
+   if (w->text_len == 0)
+      return;
+   if (w->echo && fwrite(w->text, 1, w->text_len, stdout) != w->text_len)
+      w->err = 1;
+   if (w->fp && w->format == SPW_TEXT &&
+       fwrite(w->text, 1, w->text_len, w->fp) != w->text_len)
+      w->err = 1;
+   w->text_len = 0;
+}
+
+static void flush_bin(spectrum_writer *w)
+{
+   if (w->bin_len == 0)
+      return;
+   if (fwrite(w->bin, 1, w->bin_len, w->fp) != w->bin_len)
+      w->err = 1;
+   w->bin_len = 0;
+}
+
+/* Room for one more line of text. */
+static char *text_at(spectrum_writer *w)
+{
+   if (w->text_len + MAX_LINE > BUF_SIZE)
+      flush_text(w);
+   return w->text + w->text_len;
+}
+
+static void put_text(spectrum_writer *w, const char *s)
+{
+   size_t len = strlen(s);
+
+   memcpy(text_at(w), s, len);
+   w->text_len += len;
+}
+
+#define PUT_LITERAL(p, s) (memcpy(p, s, sizeof(s) - 1), (p) += sizeof(s) - 1)
+
+/* "X[i]:real == re imaginary == im" */
+static void put_bin_line(spectrum_writer *w, int i, double re, double im)
+{
+   char *p = text_at(w), *start = p;
+
+   PUT_LITERAL(p, "X[");
+   p += put_int(p, i);
+   PUT_LITERAL(p, "]:real == ");
+   p += spw_format(p, re, 0);
+   PUT_LITERAL(p, " imaginary == ");
+   p += spw_format(p, im, 0);
+   *p++ = '\n';
+   w->text_len += p - start;
+}
+
+/* Room for len more bytes of records. */
+static unsigned char *bin_at(spectrum_writer *w, size_t len)
+{
+   if (w->bin_len + len > BUF_SIZE)
+      flush_bin(w);
+   return w->bin + w->bin_len;
+}
+
+static void put_bin(spectrum_writer *w, const void *data, size_t len)
+{
+   memcpy(bin_at(w, len), data, len);
+   w->bin_len += len;
+}
+
+static void put_record(spectrum_writer *w, int32_t section, int32_t count)
+{
+   int32_t rec[2] = { section, count };
+   put_bin(w, rec, sizeof(rec));
+}
+
+/* Values as float32, a buffer's worth at a time. */
+static void put_floats(spectrum_writer *w, const double *v, int n,
+                       int stride, double scale)
+{
+   float f[MAX_LINE / sizeof(float)];
+   int i, k;
+
+   for (i = 0; i < n; i += k)
+   {
+      for (k = 0; k < (int)(sizeof(f) / sizeof(f[0])) && i + k < n; k++)
+         f[k] = v[(size_t)(i + k) * stride] * scale;
+      put_bin(w, f, k * sizeof(f[0]));
+   }
+}
+
+spectrum_writer *spw_open(const char *path, int format, int sections,
+                          int echo)
+{
+   spectrum_writer *w;
+
+   w = calloc(1, sizeof(*w));
+   if (!w)
+      return NULL;
+   w->format = format;
+   w->sections = sections;
+   w->echo = echo;
+   w->want_text = echo || (path && format == SPW_TEXT);
+   w->text = malloc(BUF_SIZE);
+   w->bin = malloc(BUF_SIZE);
+   if (path)
+      w->fp = fopen(path, format == SPW_BINARY ? "wb" : "w");
+   if (!w->text || !w->bin || (path && !w->fp))
+   {
+      spw_close(w);
+      return NULL;
+   }
+   if (w->fp && format == SPW_BINARY)
+   {
+      int32_t hdr[3] = { 1, sections, 0 };
+      put_bin(w, "SPEC", 4);
+      put_bin(w, hdr, sizeof(hdr));
+   }
+   return w;
+}
+
+void spw_input(spectrum_writer *w, const double *x, int n)
+{
+   int i;
+
+   if (!(w->sections & SPW_INPUT))
+      return;
+   if (w->want_text)
+   {
+      put_text(w, "*********Before*********\n");
+      for (i = 0; i < n; i++)
+         put_bin_line(w, i, x[i], 0.0);
+   }
+   if (w->fp && w->format == SPW_BINARY)
+   {
+      put_record(w, SPW_INPUT, n);
+      put_floats(w, x, n, 1, 1.0);
+   }
+}
+
+void spw_bins(spectrum_writer *w, const struct Complex *X, int n,
+              double scale)
+{
+   int i;
+
+   if (!(w->sections & SPW_BINS))
+      return;
+   if (w->want_text)
+   {
+      put_text(w, "\n\n**********After*********\n");
+      for (i = 0; i < n; i++)
+         put_bin_line(w, i, X[i].a * scale, X[i].b * scale);
+   }
+   if (w->fp && w->format == SPW_BINARY)
+   {
+      put_record(w, SPW_BINS, n);
+      put_floats(w, &X[0].a, 2 * n, 1, scale);
+   }
+}
+
+void spw_power(spectrum_writer *w, const float *pm, int n)
+{
+   char *p, *start;
+   int i;
+
+   if (!(w->sections & SPW_POWER))
+      return;
+   if (w->want_text)
+   {
+      put_text(w, "\n\n************ Calculate Power ********\n\n");
+      for (i = 0; i < n; i++)
+      {
+         p = start = text_at(w);
+         PUT_LITERAL(p, "Power is ");
+         p += spw_format(p, pm[i], 1);
+         *p++ = '\n';
+         w->text_len += p - start;
+      }
+   }
+   if (w->fp && w->format == SPW_BINARY)
+   {
+      put_record(w, SPW_POWER, n);
+      put_bin(w, pm, n * sizeof(*pm));
+   }
+}
+
+void spw_verdict(spectrum_writer *w, long long frame, int bin, float power,
+                 int valid)
+{
+   char *p, *start;
+
+   if (!(w->sections & SPW_VERDICT))
+      return;
+   if (w->want_text)
+   {
+      p = start = text_at(w);
+      if (frame >= 0)
+      {
+         PUT_LITERAL(p, "frame ");
+         p += put_int(p, frame);
+         PUT_LITERAL(p, ": ");
+      }
+      PUT_LITERAL(p, "power at N = ");
+      p += put_int(p, bin);
+      PUT_LITERAL(p, " is ");
+      p += spw_format(p, power, 1);
+      if (frame >= 0)
+      {
+         if (valid)
+            PUT_LITERAL(p, ", data is valid\n");
+         else
+            PUT_LITERAL(p, ", Data invalid\n");
+      }
+      else if (valid)
+         PUT_LITERAL(p, "\ndata is valid\n");
+      else
+         PUT_LITERAL(p, "\nData invalid\n");
+      w->text_len += p - start;
+   }
+   if (w->fp && w->format == SPW_BINARY)
+   {
+      int32_t b = bin, v = valid != 0;
+      put_record(w, SPW_VERDICT, 1);
+      put_bin(w, &b, sizeof(b));
+      put_bin(w, &power, sizeof(power));
+      put_bin(w, &v, sizeof(v));
+   }
+}
+
+int spw_close(spectrum_writer *w)
+{
+   int err;
+
+   if (!w)
+      return 0;
+   if (w->text)
+      flush_text(w);
+   if (w->fp && w->bin)
+      flush_bin(w);
+   if (w->echo)
+      fflush(stdout);
+   err = w->err;
+   if (w->fp && fclose(w->fp) != 0)
+      err = 1;
+   free(w->text);
+   free(w->bin);
+   free(w);
+   return err ? -1 : 0;
+}
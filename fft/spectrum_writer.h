@@ -0,0 +1,65 @@
+/*
+ * spectrum_writer.h
+ *
+ * Output of rohan_fft.c: the input samples, the complex bins, the power
+ * spectrum and the validity verdict, formatted once into one buffer and
+ * written in large blocks to the output file and, unless quiet, to the
+ * terminal as well.
+ *
+ * Text output keeps the lines rohan_pwm has always had, but numbers are
+ * written with the fewest digits that read back to the same value
+ * (float32 for the power, double for the rest) rather than with %f.
+ *
+ * Binary output is float32 throughout: a 16-byte header, the characters
+ * "SPEC" then int32 version = 1, sections and 0, followed by a record per
+ * section written, each an int32 section bit and an int32 count, then
+ *
+ *   SPW_INPUT    count samples
+ *   SPW_BINS     count bins as real, imaginary pairs
+ *   SPW_POWER    count power values
+ *   SPW_VERDICT  count = 1: int32 bin, float32 power at that bin,
+ *                int32 1 if valid and 0 if not
+ *
+ * in the machine's byte order.  -b writes one set of records per frame.
+ */
+#ifndef SPECTRUM_WRITER_H
+#define SPECTRUM_WRITER_H
+
+#include "fft.h"
+
+/* Sections, or-ed together. */
+#define SPW_INPUT   0x1
+#define SPW_BINS    0x2
+#define SPW_POWER   0x4
+#define SPW_VERDICT 0x8
+#define SPW_ALL     0xf
+
+#define SPW_TEXT    0
+#define SPW_BINARY  1
+
+typedef struct spectrum_writer spectrum_writer;
+
+/* Writes the chosen sections to path (may be NULL for none) in format,
+   and in text to stdout as well when echo is set.  Returns NULL if path
+   cannot be created or when out of memory. */
+spectrum_writer *spw_open(const char *path, int format, int sections,
+                          int echo);
+
+/* Each call writes its section if it was chosen and does nothing if not.
+   frame numbers the verdict lines of a multi-frame run; -1 gives the
+   single-frame wording. */
+void spw_input(spectrum_writer *w, const double *x, int n);
+void spw_bins(spectrum_writer *w, const struct Complex *X, int n,
+              double scale);
+void spw_power(spectrum_writer *w, const float *pm, int n);
+void spw_verdict(spectrum_writer *w, long long frame, int bin, float power,
+                 int valid);
+
+/* Flushes and closes.  Returns -1 if anything could not be written. */
+int spw_close(spectrum_writer *w);
+
+/* Writes v to buf in the fewest significant digits that read back as the
+   same float (single set) or double, and returns the length. */
+int spw_format(char *buf, double v, int single);
+
+#endif